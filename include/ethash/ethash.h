@@ -7,6 +7,7 @@
 
 #include <ethash/hash_types.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifndef __has_cpp_attribute
@@ -49,7 +50,14 @@ enum ethash_errc
 {
     ETHASH_SUCCESS = 0,
     ETHASH_INVALID_FINAL_HASH = 1,
-    ETHASH_INVALID_MIX_HASH = 2
+    ETHASH_INVALID_MIX_HASH = 2,
+    ETHASH_INVALID_HEADER = 3,
+
+    /** The epoch number is out of the supported range. */
+    ETHASH_INVALID_EPOCH_NUMBER = 4,
+
+    /** The epoch context cannot be created because of memory allocation failure. */
+    ETHASH_OUT_OF_MEMORY = 5
 };
 typedef enum ethash_errc ethash_errc;
 
@@ -73,11 +81,70 @@ struct ethash_result
 };
 
 
+/**
+ * The difficulty converted to the boundary once, to check many final hashes against it.
+ * See ethash_prepare_target().
+ */
+struct ethash_target
+{
+    /** The boundary = 2^256 / difficulty as big-endian 256-bit value. */
+    union ethash_hash256 boundary;
+
+    /** The most significant 64-bit word of the boundary as a native number. */
+    uint64_t boundary_top_word;
+};
+
+/** The Ethash seal of a block header together with the data needed to verify it. */
+struct ethash_header_seal
+{
+    /** The hash of the block header without the seal fields (mix hash and nonce). */
+    union ethash_hash256 header_hash;
+
+    /** The mix hash from the seal. */
+    union ethash_hash256 mix_hash;
+
+    /** The difficulty as big-endian 256-bit value. */
+    union ethash_hash256 difficulty;
+
+    /** The nonce from the seal. */
+    uint64_t nonce;
+
+    /** The block number. */
+    int block_number;
+};
+
+
+/** The statistics of the full dataset item cache. */
+struct ethash_item_cache_stats
+{
+    /** The number of dataset lookups served from the cache. */
+    uint64_t hits;
+
+    /** The number of dataset lookups which required computing the item. */
+    uint64_t misses;
+
+    /** The number of items the cache can hold. */
+    size_t capacity;
+};
+
+/** The statistics of the verified seal cache. */
+struct ethash_seal_cache_stats
+{
+    /** The number of verifications which found the seal in the cache. */
+    uint64_t hits;
+
+    /** The number of verifications which required computing the mix hash. */
+    uint64_t misses;
+
+    /** The number of seals the cache can hold. */
+    size_t capacity;
+};
+
+
 /**
  * Calculates the number of items in the light cache for given epoch.
  *
- * This function will search for a prime number matching the criteria given
- * by the Ethash so the execution time is not constant. It takes ~ 0.01 ms.
+ * The numbers of items of all epochs are precomputed so this is a table lookup.
  *
  * @param epoch_number  The epoch number.
  * @return              The number items in the light cache.
@@ -88,8 +155,7 @@ int ethash_calculate_light_cache_num_items(int epoch_number) noexcept;
 /**
  * Calculates the number of items in the full dataset for given epoch.
  *
- * This function will search for a prime number matching the criteria given
- * by the Ethash so the execution time is not constant. It takes ~ 0.05 ms.
+ * The numbers of items of all epochs are precomputed so this is a table lookup.
  *
  * @param epoch_number  The epoch number.
  * @return              The number items in the full dataset.
@@ -119,14 +185,127 @@ struct ethash_epoch_context* ethash_create_epoch_context(int epoch_number) noexc
  */
 struct ethash_epoch_context_full* ethash_create_epoch_context_full(int epoch_number) noexcept;
 
+/**
+ * Creates the epoch context with the full dataset initialized out of the existing epoch context.
+ *
+ * The light cache is copied from the given context instead of being built, which is much
+ * cheaper. See ethash_create_epoch_context_full().
+ *
+ * @param context  The epoch context to copy the light cache from.
+ * @return  Pointer to the context or null in case of memory allocation failure.
+ */
+struct ethash_epoch_context_full* ethash_create_epoch_context_full_from_light(
+    const struct ethash_epoch_context* context) noexcept;
+
 void ethash_destroy_epoch_context(struct ethash_epoch_context* context) noexcept;
 
 void ethash_destroy_epoch_context_full(struct ethash_epoch_context_full* context) noexcept;
 
+/**
+ * Generates the full dataset items in the range [first, first + count).
+ *
+ * The full dataset can be generated up front, e.g. by splitting the whole range of items
+ * between threads. When all the items have been generated by this function the hash
+ * computations skip the check for not yet generated items.
+ * The ranges may overlap, the items already generated are skipped.
+ *
+ * @param context  The epoch context with the full dataset.
+ * @param first    The index of the first item to generate.
+ * @param count    The number of items to generate. The range is clamped to the dataset size.
+ */
+void ethash_generate_full_dataset_items(
+    const struct ethash_epoch_context_full* context, int first, int count) noexcept;
+
+/**
+ * Attaches the cache of full dataset items to the epoch context.
+ *
+ * The light hashing and verification functions store the full dataset items they compute
+ * in the cache and reuse them in following invocations. This helps when many hashes are
+ * verified within the same epoch. The cache is concurrent and the lookups never block.
+ * The cache is destroyed together with the context by ethash_destroy_epoch_context().
+ *
+ * At most 64 contexts can have caches (item or seal caches) attached at the same time.
+ * The caches are kept in a registry by the context address, epoch number and light cache.
+ * A context freed otherwise than by ethash_destroy_epoch_context() keeps its registry entry
+ * and caches until a new context at the same address gets caches attached or is destroyed.
+ *
+ * @param context  The epoch context created by this library.
+ * @param size     The memory budget of the cache in bytes. From tens of MB up to the size
+ *                 of the full dataset.
+ * @return  True if the cache has been attached, false if the context already has a cache,
+ *          too many contexts have caches attached or in case of memory allocation failure.
+ */
+bool ethash_attach_item_cache(const struct ethash_epoch_context* context, size_t size) noexcept;
+
+/**
+ * Gets the statistics of the full dataset item cache attached to the epoch context.
+ *
+ * @return  The statistics or all zeros if the context has no cache attached.
+ */
+struct ethash_item_cache_stats ethash_get_item_cache_stats(
+    const struct ethash_epoch_context* context) noexcept;
+
+/**
+ * Attaches the cache of verified seals to the epoch context.
+ *
+ * The verification functions remember the seals (header hash, nonce and mix hash) which have
+ * passed the mix hash check with the context and accept them again without computing
+ * the Ethash hash. This helps when the same headers are verified multiple times, e.g. when
+ * announced by many peers. The final hash is always checked. The cache is concurrent,
+ * the lookups never block. The cache is destroyed together with the context
+ * by ethash_destroy_epoch_context().
+ *
+ * At most 64 contexts can have caches attached at the same time,
+ * see ethash_attach_item_cache().
+ *
+ * @param context  The epoch context created by this library.
+ * @param size     The memory budget of the cache in bytes. Each seal takes about 80 bytes.
+ * @return  True if the cache has been attached, false if the context already has a cache,
+ *          too many contexts have caches attached or in case of memory allocation failure.
+ */
+bool ethash_attach_seal_cache(const struct ethash_epoch_context* context, size_t size) noexcept;
+
+/**
+ * Gets the statistics of the verified seal cache attached to the epoch context.
+ *
+ * @return  The statistics or all zeros if the context has no cache attached.
+ */
+struct ethash_seal_cache_stats ethash_get_seal_cache_stats(
+    const struct ethash_epoch_context* context) noexcept;
+
 
 struct ethash_result ethash_hash(const struct ethash_epoch_context* context,
     const union ethash_hash256* header_hash, uint64_t nonce) noexcept;
 
+/**
+ * Converts the difficulty to the boundary.
+ *
+ * The Ethash final hash is valid if hash <= (2^256 / difficulty). This function computes
+ * boundary = (2^256 / difficulty). For the difficulty of 0 and 1 the boundary is 2^256 - 1.
+ *
+ * @param difficulty  The difficulty number as big-endian 256-bit value.
+ * @return            The boundary as big-endian 256-bit value.
+ */
+union ethash_hash256 ethash_difficulty_to_boundary(const union ethash_hash256* difficulty) noexcept;
+
+/**
+ * Prepares the target out of the difficulty.
+ *
+ * The final hash checks against the target are equivalent to the checks against the difficulty
+ * but most of them only compare the most significant words. This pays off when many hashes
+ * are checked against the same difficulty, e.g. the shares of a mining pool.
+ *
+ * @param difficulty  The difficulty number as big-endian 256-bit value.
+ * @return            The target.
+ */
+struct ethash_target ethash_prepare_target(const union ethash_hash256* difficulty) noexcept;
+
+/**
+ * Checks if the final hash satisfies the target, i.e. final_hash <= boundary.
+ */
+bool ethash_check_target(
+    const struct ethash_target* target, const union ethash_hash256* final_hash) noexcept;
+
 /**
  * Verify Ethash validity of a header hash against given boundary.
  *
@@ -166,6 +345,47 @@ ethash_errc ethash_verify_against_difficulty(const struct ethash_epoch_context*
     const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
     const union ethash_hash256* difficulty) noexcept;
 
+/**
+ * Verify Ethash validity of a header hash against given boundary using the full dataset.
+ *
+ * This is equivalent to ethash_verify_against_boundary() but the full dataset items
+ * are taken from the full dataset (or generated there lazily) instead of being computed
+ * out of the light cache. This is much faster when the full context is already available.
+ */
+ethash_errc ethash_verify_against_boundary_full(const struct ethash_epoch_context_full* context,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const union ethash_hash256* boundary) noexcept;
+
+/**
+ * Verify Ethash validity of a header hash against given difficulty using the full dataset.
+ *
+ * This is equivalent to ethash_verify_against_difficulty() but the full dataset items
+ * are taken from the full dataset (or generated there lazily) instead of being computed
+ * out of the light cache. This is much faster when the full context is already available.
+ */
+ethash_errc ethash_verify_against_difficulty_full(const struct ethash_epoch_context_full* context,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const union ethash_hash256* difficulty) noexcept;
+
+/**
+ * Verify Ethash validity of a header hash against the prepared target.
+ *
+ * This is equivalent to ethash_verify_against_difficulty() with the difficulty the target
+ * has been prepared from. See ethash_prepare_target().
+ */
+ethash_errc ethash_verify_against_target(const struct ethash_epoch_context* context,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const struct ethash_target* target) noexcept;
+
+/**
+ * Verify Ethash validity of a header hash against the prepared target using the full dataset.
+ *
+ * See ethash_verify_against_target() and ethash_verify_against_difficulty_full().
+ */
+ethash_errc ethash_verify_against_target_full(const struct ethash_epoch_context_full* context,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const struct ethash_target* target) noexcept;
+
 
 /**
  * Verify only the final hash. This can be performed quickly without accessing Ethash context.
@@ -177,6 +397,34 @@ ethash_errc ethash_verify_final_hash_against_difficulty(const union ethash_hash2
     const union ethash_hash256* mix_hash, uint64_t nonce,
     const union ethash_hash256* difficulty) noexcept;
 
+/**
+ * Verify only the final hash against the prepared target. See ethash_prepare_target().
+ *
+ * @return  Error code: ::ETHASH_SUCCESS if valid, ::ETHASH_INVALID_FINAL_HASH if the final hash
+ *          does not satisfy the target.
+ */
+ethash_errc ethash_verify_final_hash_against_target(const union ethash_hash256* header_hash,
+    const union ethash_hash256* mix_hash, uint64_t nonce,
+    const struct ethash_target* target) noexcept;
+
+/**
+ * Decodes the seal of the RLP-encoded block header.
+ *
+ * The difficulty, block number, mix hash and nonce fields are located in place.
+ * The header hash is computed by streaming the header bytes around the mix hash and nonce fields
+ * to Keccak-256, preceded by the list prefix adjusted to the shorter payload, so the header is
+ * not re-encoded nor copied.
+ *
+ * @param header       The RLP-encoded block header.
+ * @param header_size  The size of the encoded header.
+ * @param seal         The output header seal, unspecified in case of an error.
+ * @return             Error code: ::ETHASH_SUCCESS if decoded, ::ETHASH_INVALID_HEADER if
+ *                     the header is not a canonical RLP list of at least 15 fields, the field
+ *                     types do not match or the block number is beyond the supported epochs.
+ */
+ethash_errc ethash_decode_header_seal(
+    const uint8_t* header, size_t header_size, struct ethash_header_seal* seal) noexcept;
+
 #ifdef __cplusplus
 }
 #endif
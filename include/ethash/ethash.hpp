@@ -49,6 +49,10 @@ using epoch_context = ethash_epoch_context;
 using epoch_context_full = ethash_epoch_context_full;
 
 using result = ethash_result;
+using header_seal = ethash_header_seal;
+using prepared_target = ethash_target;
+using item_cache_stats = ethash_item_cache_stats;
+using seal_cache_stats = ethash_seal_cache_stats;
 
 /// Constructs a 256-bit hash from an array of bytes.
 ///
@@ -134,6 +138,38 @@ inline epoch_context_full_ptr create_epoch_context_full(int epoch_number) noexce
     return {ethash_create_epoch_context_full(epoch_number), ethash_destroy_epoch_context_full};
 }
 
+/// Creates Ethash epoch context with the full dataset out of the existing epoch context.
+/// See ethash_create_epoch_context_full_from_light().
+inline epoch_context_full_ptr create_epoch_context_full(const epoch_context& context) noexcept
+{
+    return {ethash_create_epoch_context_full_from_light(&context),
+        ethash_destroy_epoch_context_full};
+}
+
+/// Alias for ethash_attach_item_cache().
+inline bool attach_item_cache(const epoch_context& context, size_t size) noexcept
+{
+    return ethash_attach_item_cache(&context, size);
+}
+
+/// Alias for ethash_get_item_cache_stats().
+inline item_cache_stats get_item_cache_stats(const epoch_context& context) noexcept
+{
+    return ethash_get_item_cache_stats(&context);
+}
+
+/// Alias for ethash_attach_seal_cache().
+inline bool attach_seal_cache(const epoch_context& context, size_t size) noexcept
+{
+    return ethash_attach_seal_cache(&context, size);
+}
+
+/// Alias for ethash_get_seal_cache_stats().
+inline seal_cache_stats get_seal_cache_stats(const epoch_context& context) noexcept
+{
+    return ethash_get_seal_cache_stats(&context);
+}
+
 
 inline result hash(
     const epoch_context& context, const hash256& header_hash, uint64_t nonce) noexcept
@@ -143,6 +179,64 @@ inline result hash(
 
 result hash(const epoch_context_full& context, const hash256& header_hash, uint64_t nonce) noexcept;
 
+/// Calculates the full dataset item of the given index out of the light cache.
+///
+/// This consist of two 512-bit items defined by the Ethash specification, but these items
+/// are never needed separately.
+hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t index) noexcept;
+
+/// Alias for ethash_generate_full_dataset_items().
+inline void generate_full_dataset_items(
+    const epoch_context_full& context, int first, int count) noexcept
+{
+    ethash_generate_full_dataset_items(&context, first, count);
+}
+
+/// Alias for ethash_difficulty_to_boundary().
+inline hash256 difficulty_to_boundary(const hash256& difficulty) noexcept
+{
+    return ethash_difficulty_to_boundary(&difficulty);
+}
+
+/// Alias for ethash_prepare_target().
+inline prepared_target prepare_target(const hash256& difficulty) noexcept
+{
+    return ethash_prepare_target(&difficulty);
+}
+
+/// Alias for ethash_check_target().
+inline bool check_target(const prepared_target& t, const hash256& final_hash) noexcept
+{
+    return ethash_check_target(&t, &final_hash);
+}
+
+inline std::error_code verify_final_hash_against_target(const hash256& header_hash,
+    const hash256& mix_hash, uint64_t nonce, const prepared_target& t) noexcept
+{
+    return ethash_verify_final_hash_against_target(&header_hash, &mix_hash, nonce, &t);
+}
+
+inline std::error_code verify_against_target(const epoch_context& context,
+    const hash256& header_hash, const hash256& mix_hash, uint64_t nonce,
+    const prepared_target& t) noexcept
+{
+    return ethash_verify_against_target(&context, &header_hash, &mix_hash, nonce, &t);
+}
+
+inline std::error_code verify_against_target(const epoch_context_full& context,
+    const hash256& header_hash, const hash256& mix_hash, uint64_t nonce,
+    const prepared_target& t) noexcept
+{
+    return ethash_verify_against_target_full(&context, &header_hash, &mix_hash, nonce, &t);
+}
+
+/// Decodes the seal of the RLP-encoded block header. See ethash_decode_header_seal().
+inline std::error_code decode_header_seal(
+    header_seal& seal, const uint8_t* header, size_t header_size) noexcept
+{
+    return ethash_decode_header_seal(header, header_size, &seal);
+}
+
 inline std::error_code verify_final_hash_against_difficulty(const hash256& header_hash,
     const hash256& mix_hash, uint64_t nonce, const hash256& difficulty) noexcept
 {
@@ -163,6 +257,21 @@ inline std::error_code verify_against_boundary(const epoch_context& context,
     return ethash_verify_against_boundary(&context, &header_hash, &mix_hash, nonce, &boundary);
 }
 
+inline std::error_code verify_against_difficulty(const epoch_context_full& context,
+    const hash256& header_hash, const hash256& mix_hash, uint64_t nonce,
+    const hash256& difficulty) noexcept
+{
+    return ethash_verify_against_difficulty_full(
+        &context, &header_hash, &mix_hash, nonce, &difficulty);
+}
+
+inline std::error_code verify_against_boundary(const epoch_context_full& context,
+    const hash256& header_hash, const hash256& mix_hash, uint64_t nonce,
+    const hash256& boundary) noexcept
+{
+    return ethash_verify_against_boundary_full(&context, &header_hash, &mix_hash, nonce, &boundary);
+}
+
 [[deprecated("use verify_against_boundary()")]] inline std::error_code verify(
     const epoch_context& context, const hash256& header_hash, const hash256& mix_hash,
     uint64_t nonce, const hash256& boundary) noexcept
@@ -205,10 +314,31 @@ inline const std::error_category& ethash_category() noexcept
                 return "invalid final hash";
             case ETHASH_INVALID_MIX_HASH:
                 return "invalid mix hash";
+            case ETHASH_INVALID_HEADER:
+                return "invalid header";
+            case ETHASH_INVALID_EPOCH_NUMBER:
+                return "invalid epoch number";
+            case ETHASH_OUT_OF_MEMORY:
+                return "out of memory";
             default:
                 return "unknown error";
             }
         }
+
+        /// Maps the errors not specific to Ethash to the generic error conditions,
+        /// so they compare equal to std::errc::invalid_argument and std::errc::not_enough_memory.
+        std::error_condition default_error_condition(int ev) const noexcept final
+        {
+            switch (ev)
+            {
+            case ETHASH_INVALID_EPOCH_NUMBER:
+                return std::errc::invalid_argument;
+            case ETHASH_OUT_OF_MEMORY:
+                return std::errc::not_enough_memory;
+            default:
+                return {ev, *this};
+            }
+        }
     };
 
     static ethash_category_impl category_instance;
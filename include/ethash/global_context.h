@@ -10,17 +10,389 @@
 extern "C" {
 #endif
 
+/** The memory usage of a context allocated by the global context manager. */
+struct ethash_global_context_memory_usage
+{
+    int epoch_number;
+
+    /** The context has the full dataset. */
+    bool full;
+
+    /** The context is in the global cache. Otherwise it is only kept alive by references. */
+    bool cached;
+
+    /** The memory size of the light cache and the full dataset. */
+    size_t memory_size;
+};
+
+/** The statistics of the global context manager. */
+struct ethash_global_context_stats
+{
+    /** The number of requests served by the context already used by the calling thread. */
+    uint64_t thread_local_hits;
+
+    /** The number of requests served by the contexts in the global cache. */
+    uint64_t shared_hits;
+
+    /** The number of requests for which the context had to be built, or waited for. */
+    uint64_t misses;
+
+    /** The number of light contexts built. */
+    uint64_t light_builds;
+
+    /** The cumulative duration of the light context builds in nanoseconds. */
+    uint64_t light_build_time_ns;
+
+    /** The duration of the last light context build in nanoseconds. */
+    uint64_t last_light_build_time_ns;
+
+    /** The number of full contexts built, including the full dataset generation if prepared. */
+    uint64_t full_builds;
+
+    /** The cumulative duration of the full context builds in nanoseconds. */
+    uint64_t full_build_time_ns;
+
+    /** The duration of the last full context build in nanoseconds. */
+    uint64_t last_full_build_time_ns;
+
+    /** The number of times a thread had to wait for the lock of the global cache. */
+    uint64_t lock_waits;
+
+    /** The cumulative time spent waiting for the lock of the global cache in nanoseconds. */
+    uint64_t lock_wait_time_ns;
+
+    /**
+     * The memory size of all the allocated contexts.
+     * See ethash_global_context_get_memory_usage() for the usage per epoch.
+     */
+    size_t memory_size;
+};
+
+/**
+ * Sets the capacity of the global cache of shared light epoch contexts.
+ *
+ * The cache keeps the light contexts of recently used epochs so that switching between them,
+ * e.g. around an epoch boundary, does not rebuild the light cache. When the capacity is
+ * exceeded the least recently used contexts are released. The contexts are freed
+ * when no thread uses them anymore. By default the cache keeps 3 epochs without the memory limit.
+ *
+ * @param max_num_epochs  The maximum number of cached epoch contexts. Values < 1 mean 1.
+ * @param memory_budget   The maximum memory size in bytes of all cached light caches.
+ *                        Zero means no limit. The most recently used context is always kept.
+ */
+void ethash_global_context_set_capacity(int max_num_epochs, size_t memory_budget) noexcept;
+
+/**
+ * Requests building the light context of the given epoch in the background.
+ *
+ * The context is built by a background thread and inserted into the global cache
+ * of shared light contexts, so the later ethash_get_global_epoch_context() does not block.
+ * Nothing is done if the context is already available or the epoch number is invalid.
+ */
+void ethash_global_context_prefetch(int epoch_number) noexcept;
+
+/**
+ * Sets the distance for the automatic prefetching of the next epoch context.
+ *
+ * When the chain head reported by ethash_global_context_update_head() gets within the given
+ * number of blocks of the next epoch, the light context of the next epoch is prefetched.
+ *
+ * @param num_blocks  The distance in blocks. Zero (the default) disables the automatic mode.
+ */
+void ethash_global_context_set_prefetch_distance(int num_blocks) noexcept;
+
+/**
+ * Reports the block number of the chain head for the automatic prefetching.
+ *
+ * This is cheap and can be called for every block. The verification functions do not report
+ * the head, the batches may come from anywhere in the chain.
+ * See ethash_global_context_set_prefetch_distance().
+ */
+void ethash_global_context_update_head(int block_number) noexcept;
+
+/**
+ * Prepares the full context of the given epoch in the background.
+ *
+ * The full dataset is generated by the given number of low-priority background threads while
+ * the full context currently in use stays available. The prepared context is published when
+ * complete. The threads switch to it with ethash_get_global_epoch_context_full()
+ * or ethash_try_get_global_epoch_context_full(). The full contexts of older epochs are released
+ * when a thread gets the new one with ethash_get_global_epoch_context_full(). At most two full
+ * contexts are kept.
+ *
+ * @param epoch_number  The epoch number, usually the next one.
+ * @param num_threads   The number of threads to generate the full dataset.
+ *                      Values <= 0 select the number of hardware threads.
+ * @return              True if the context is already available or is being prepared.
+ *                      False if the epoch number is invalid or the full contexts would not fit
+ *                      in the memory limit, see ethash_global_context_set_full_memory_limit().
+ */
+bool ethash_global_context_prepare_full(int epoch_number, int num_threads) noexcept;
+
+/**
+ * Sets the memory limit for the shared full contexts.
+ *
+ * The limit controls whether the full context in use and the new one can coexist.
+ * If not, preparing the new one is refused and the full context in use is released before
+ * building the new one on demand.
+ *
+ * @param memory_limit  The limit in bytes. Zero (the default) means no limit.
+ */
+void ethash_global_context_set_full_memory_limit(size_t memory_limit) noexcept;
+
+/**
+ * Sets the memory budget for all the contexts allocated by the global context manager.
+ *
+ * The budget covers the contexts in the global cache and the contexts evicted from the cache
+ * but still referenced. When a new context would exceed the budget, the least recently used
+ * contexts not referenced by any thread are released. If this is not enough, building the full
+ * context is refused (null is returned) while the light context is built anyway.
+ * This is independent of the limits set by ethash_global_context_set_capacity()
+ * and ethash_global_context_set_full_memory_limit().
+ *
+ * @param memory_budget  The budget in bytes. Zero (the default) means no limit.
+ */
+void ethash_global_context_set_memory_budget(size_t memory_budget) noexcept;
+
+/**
+ * Returns the memory size of all the contexts allocated by the global context manager.
+ */
+size_t ethash_global_context_get_memory_size() noexcept;
+
+/**
+ * Reports the memory usage of each context allocated by the global context manager.
+ *
+ * @param entries          The output array of memory usage entries, one per context.
+ * @param max_num_entries  The size of the entries array.
+ * @return                 The number of allocated contexts. Only up to max_num_entries entries
+ *                         are written.
+ */
+size_t ethash_global_context_get_memory_usage(
+    struct ethash_global_context_memory_usage* entries, size_t max_num_entries) noexcept;
+
+/**
+ * Returns the statistics of the global context manager.
+ *
+ * The counters are cumulative since the start of the process. The thread-local hits are
+ * counted per thread without synchronization, so the recent hits of other threads may
+ * be missing.
+ */
+struct ethash_global_context_stats ethash_global_context_get_stats() noexcept;
+
 /**
  * Get global shared epoch context.
+ *
+ * If the context is not available it is built. The context is built only once
+ * even if requested by multiple threads concurrently. The build does not block
+ * the threads using other contexts. The light context is separate from the full context
+ * of the same epoch, so using it does not keep the full dataset alive.
  */
 const struct ethash_epoch_context* ethash_get_global_epoch_context(int epoch_number) noexcept;
 
 /**
  * Get global shared epoch context with full dataset initialized.
+ *
+ * See ethash_get_global_epoch_context(). The full context of the previous epoch is released
+ * after the new one is built, unless the memory limit requires releasing it before.
+ * If the light context of the epoch is available, the full context shares its light cache
+ * instead of building another copy, and keeps the light context alive. The light context stays
+ * in the cache.
  */
 const struct ethash_epoch_context_full* ethash_get_global_epoch_context_full(
     int epoch_number) noexcept;
 
+/**
+ * Try to get global shared epoch context without blocking.
+ *
+ * Returns null if the context of the given epoch has not been built yet. The context previously
+ * obtained by the calling thread stays valid then, so the thread can keep using it until
+ * the new one is available. This function never builds nor releases contexts.
+ */
+const struct ethash_epoch_context* ethash_try_get_global_epoch_context(int epoch_number) noexcept;
+
+/**
+ * Try to get global shared epoch context with full dataset initialized without blocking.
+ *
+ * The same as ethash_try_get_global_epoch_context(): returns null if the full context of
+ * the given epoch has not been built yet and the full context previously obtained by the calling
+ * thread stays valid. This function never builds nor releases contexts,
+ * see ethash_global_context_prepare_full().
+ */
+const struct ethash_epoch_context_full* ethash_try_get_global_epoch_context_full(
+    int epoch_number) noexcept;
+
+/**
+ * Acquires the reference to the global shared epoch context.
+ *
+ * Unlike ethash_get_global_epoch_context(), the reference is not owned by the calling thread.
+ * The context stays valid until the reference is released with ethash_epoch_context_release(),
+ * also after it is evicted from the global cache. The context is built if not available.
+ *
+ * @return  The context or null in case of invalid epoch number or memory allocation failure.
+ */
+const struct ethash_epoch_context* ethash_epoch_context_acquire(int epoch_number) noexcept;
+
+/**
+ * Acquires the reference to the global shared epoch context with full dataset initialized.
+ *
+ * See ethash_epoch_context_acquire() and ethash_get_global_epoch_context_full().
+ */
+const struct ethash_epoch_context_full* ethash_epoch_context_full_acquire(
+    int epoch_number) noexcept;
+
+/**
+ * Releases the reference acquired with ethash_epoch_context_acquire().
+ *
+ * The context is destroyed when it has been evicted from the global cache and no references
+ * to it are left. Null is ignored.
+ */
+void ethash_epoch_context_release(const struct ethash_epoch_context* context) noexcept;
+
+/**
+ * Releases the reference acquired with ethash_epoch_context_full_acquire().
+ *
+ * See ethash_epoch_context_release().
+ */
+void ethash_epoch_context_full_release(const struct ethash_epoch_context_full* context) noexcept;
+
+/**
+ * Releases the references to the global shared contexts kept by the calling thread.
+ *
+ * The contexts returned by ethash_get_global_epoch_context() and similar functions are kept
+ * alive by the calling thread until it requests other epoch or exits. Call this function
+ * before a thread goes idle, so that contexts evicted from the global cache, e.g. the full
+ * dataset of an old epoch, are freed. The pointers previously returned to the calling thread
+ * must not be used afterwards.
+ */
+void ethash_global_context_purge_thread_local() noexcept;
+
+/**
+ * Verify Ethash validity of a header hash against given boundary using global shared context.
+ *
+ * The global full context is used if it is available for the given epoch,
+ * otherwise the final hash is checked first and then the global light context is used.
+ * See ethash_verify_against_boundary().
+ *
+ * @return  Error code: ::ETHASH_INVALID_EPOCH_NUMBER if the epoch number is out of the
+ *          supported range, ::ETHASH_OUT_OF_MEMORY if the context cannot be created,
+ *          otherwise see ethash_verify_against_boundary().
+ */
+ethash_errc ethash_verify_against_boundary_global(int epoch_number,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const union ethash_hash256* boundary) noexcept;
+
+/**
+ * Verify Ethash validity of a header hash against given difficulty using global shared context.
+ *
+ * The global full context is used if it is available for the given epoch,
+ * otherwise the final hash is checked first and then the global light context is used.
+ * See ethash_verify_against_difficulty().
+ *
+ * @return  Error code: ::ETHASH_INVALID_EPOCH_NUMBER if the epoch number is out of the
+ *          supported range, ::ETHASH_OUT_OF_MEMORY if the context cannot be created,
+ *          otherwise see ethash_verify_against_difficulty().
+ */
+ethash_errc ethash_verify_against_difficulty_global(int epoch_number,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const union ethash_hash256* difficulty) noexcept;
+
+/**
+ * Verify Ethash validity of a header hash against the prepared target using global shared context.
+ *
+ * The global full context is used if it is available for the given epoch,
+ * otherwise the final hash is checked first and then the global light context is used.
+ * See ethash_verify_against_target().
+ *
+ * @return  Error code: ::ETHASH_INVALID_EPOCH_NUMBER if the epoch number is out of the
+ *          supported range, ::ETHASH_OUT_OF_MEMORY if the context cannot be created,
+ *          otherwise see ethash_verify_against_target().
+ */
+ethash_errc ethash_verify_against_target_global(int epoch_number,
+    const union ethash_hash256* header_hash, const union ethash_hash256* mix_hash, uint64_t nonce,
+    const struct ethash_target* target) noexcept;
+
+/**
+ * Verifies the Ethash seal of the RLP-encoded block header using global shared context.
+ *
+ * The seal is decoded from the header in place, see ethash_decode_header_seal().
+ * The final hash is checked against the header difficulty before the epoch context is requested.
+ *
+ * @return  Error code: ::ETHASH_INVALID_HEADER if the header cannot be decoded,
+ *          otherwise see ethash_verify_against_difficulty_global().
+ */
+ethash_errc ethash_verify_header_global(const uint8_t* header, size_t header_size) noexcept;
+
+/**
+ * Verifies a batch of header seals against their difficulties using multiple threads.
+ *
+ * The cheap final hash check is done for all the seals first. The difficulty shared by
+ * consecutive seals is converted to the target (see ethash_prepare_target()) only once.
+ * The remaining seals are grouped by epoch and for each epoch the global shared context is
+ * obtained only once (the full one if already available). The Ethash hashes are verified
+ * in parallel by the calling thread and the worker threads of the pool of ethash_verify_async(),
+ * see ethash_verify_async_configure(). The chain head of the global context manager is not
+ * changed, see ethash_global_context_update_head().
+ *
+ * @param seals        The array of header seals.
+ * @param num_seals    The number of header seals.
+ * @param results      The output array of verification results, in the order of the seals.
+ *                     See ethash_verify_against_difficulty_global().
+ * @param num_threads  The number of threads to use, including the calling thread.
+ *                     Values <= 0 select the number of hardware threads.
+ */
+void ethash_verify_batch(const struct ethash_header_seal* seals, size_t num_seals,
+    ethash_errc* results, int num_threads) noexcept;
+
+/**
+ * The callback receiving the result of ethash_verify_async().
+ *
+ * It is invoked on a worker thread of the verification pool, so it should return quickly.
+ *
+ * @param seal       The verified header seal. Only valid during the callback.
+ * @param result     The verification result, see ethash_verify_against_difficulty().
+ * @param user_data  The pointer passed to ethash_verify_async().
+ */
+typedef void (*ethash_verify_callback)(
+    const struct ethash_header_seal* seal, ethash_errc result, void* user_data);
+
+/**
+ * Configures the pool of worker threads of ethash_verify_async().
+ *
+ * This must be called before the first ethash_verify_async() call, which starts the pool.
+ *
+ * @param num_threads  The number of worker threads. Values <= 0 select the number of hardware
+ *                     threads (the default).
+ * @param max_pending  The maximum number of verifications queued or in progress. Values 0 select
+ *                     the default of 1024 per worker thread.
+ * @return             False if the pool has already been started.
+ */
+bool ethash_verify_async_configure(int num_threads, size_t max_pending) noexcept;
+
+/**
+ * Verifies the header seal against its difficulty asynchronously.
+ *
+ * The verification is queued to the pool of worker threads and the callback is invoked
+ * with the result on one of the workers. The request is never blocking: when the number
+ * of pending verifications reaches the limit, the request is rejected and the caller should
+ * retry later. The workers use the global shared contexts, the full one if available.
+ * Each worker has its own queue, idle workers steal the work queued to others.
+ *
+ * @param seal       The header seal, copied. The block number must be within the range
+ *                   of supported epochs.
+ * @param callback   The callback receiving the result.
+ * @param user_data  The pointer passed to the callback.
+ * @return           True if the verification has been queued, false if it has been rejected
+ *                   because of too many pending verifications or the worker threads cannot be
+ *                   started. The callback is not invoked for rejected requests.
+ */
+bool ethash_verify_async(const struct ethash_header_seal* seal, ethash_verify_callback callback,
+    void* user_data) noexcept;
+
+/**
+ * Gets the number of verifications queued by ethash_verify_async() or in progress.
+ */
+size_t ethash_verify_async_get_num_pending() noexcept;
+
 #ifdef __cplusplus
 }
 #endif
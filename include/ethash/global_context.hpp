@@ -3,12 +3,87 @@
 // Licensed under the Apache License, Version 2.0.
 #pragma once
 
+#include <ethash/ethash.hpp>
 #include <ethash/global_context.h>
+#include <future>
+#include <memory>
+#include <vector>
 
 namespace ethash
 {
 using epoch_context = ethash_epoch_context;
 using epoch_context_full = ethash_epoch_context_full;
+using global_context_memory_usage = ethash_global_context_memory_usage;
+using global_context_stats = ethash_global_context_stats;
+
+/// Alias for ethash_global_context_set_capacity().
+inline void set_global_context_capacity(int max_num_epochs, size_t memory_budget = 0) noexcept
+{
+    ethash_global_context_set_capacity(max_num_epochs, memory_budget);
+}
+
+/// Alias for ethash_global_context_prefetch().
+inline void prefetch_global_epoch_context(int epoch_number) noexcept
+{
+    ethash_global_context_prefetch(epoch_number);
+}
+
+/// Alias for ethash_global_context_set_prefetch_distance().
+inline void set_global_context_prefetch_distance(int num_blocks) noexcept
+{
+    ethash_global_context_set_prefetch_distance(num_blocks);
+}
+
+/// Alias for ethash_global_context_update_head().
+inline void update_global_context_head(int block_number) noexcept
+{
+    ethash_global_context_update_head(block_number);
+}
+
+/// Alias for ethash_global_context_prepare_full().
+inline bool prepare_global_epoch_context_full(int epoch_number, int num_threads = 0) noexcept
+{
+    return ethash_global_context_prepare_full(epoch_number, num_threads);
+}
+
+/// Alias for ethash_global_context_set_full_memory_limit().
+inline void set_global_context_full_memory_limit(size_t memory_limit) noexcept
+{
+    ethash_global_context_set_full_memory_limit(memory_limit);
+}
+
+/// Alias for ethash_global_context_set_memory_budget().
+inline void set_global_context_memory_budget(size_t memory_budget) noexcept
+{
+    ethash_global_context_set_memory_budget(memory_budget);
+}
+
+/// Alias for ethash_global_context_get_memory_size().
+inline size_t get_global_context_memory_size() noexcept
+{
+    return ethash_global_context_get_memory_size();
+}
+
+/// Reports the memory usage of each context allocated by the global context manager.
+/// See ethash_global_context_get_memory_usage().
+inline std::vector<global_context_memory_usage> get_global_context_memory_usage()
+{
+    std::vector<global_context_memory_usage> entries(8);
+    while (true)
+    {
+        const size_t n = ethash_global_context_get_memory_usage(entries.data(), entries.size());
+        const bool complete = n <= entries.size();
+        entries.resize(n);
+        if (complete)
+            return entries;
+    }
+}
+
+/// Alias for ethash_global_context_get_stats().
+inline global_context_stats get_global_context_stats() noexcept
+{
+    return ethash_global_context_get_stats();
+}
 
 /// Get global shared epoch context.
 inline const epoch_context& get_global_epoch_context(int epoch_number) noexcept
@@ -17,8 +92,112 @@ inline const epoch_context& get_global_epoch_context(int epoch_number) noexcept
 }
 
 /// Get global shared epoch context with full dataset initialized.
-inline const epoch_context_full& get_global_epoch_context_full(int epoch_number) noexcept
+///
+/// Returns null if the context is refused by the memory budget or cannot be allocated,
+/// see ethash_get_global_epoch_context_full().
+inline const epoch_context_full* get_global_epoch_context_full(int epoch_number) noexcept
+{
+    return ethash_get_global_epoch_context_full(epoch_number);
+}
+
+/// Alias for ethash_try_get_global_epoch_context().
+inline const epoch_context* try_get_global_epoch_context(int epoch_number) noexcept
 {
-    return *ethash_get_global_epoch_context_full(epoch_number);
+    return ethash_try_get_global_epoch_context(epoch_number);
+}
+
+/// Alias for ethash_try_get_global_epoch_context_full().
+inline const epoch_context_full* try_get_global_epoch_context_full(int epoch_number) noexcept
+{
+    return ethash_try_get_global_epoch_context_full(epoch_number);
+}
+
+using global_epoch_context_ptr =
+    std::unique_ptr<const epoch_context, decltype(&ethash_epoch_context_release)>;
+
+using global_epoch_context_full_ptr =
+    std::unique_ptr<const epoch_context_full, decltype(&ethash_epoch_context_full_release)>;
+
+/// Acquires the reference to the global shared epoch context.
+/// See ethash_epoch_context_acquire().
+inline global_epoch_context_ptr acquire_global_epoch_context(int epoch_number) noexcept
+{
+    return {ethash_epoch_context_acquire(epoch_number), ethash_epoch_context_release};
+}
+
+/// Acquires the reference to the global shared epoch context with full dataset initialized.
+/// See ethash_epoch_context_full_acquire().
+inline global_epoch_context_full_ptr acquire_global_epoch_context_full(int epoch_number) noexcept
+{
+    return {ethash_epoch_context_full_acquire(epoch_number), ethash_epoch_context_full_release};
+}
+
+/// Alias for ethash_global_context_purge_thread_local().
+inline void purge_global_context_thread_local() noexcept
+{
+    ethash_global_context_purge_thread_local();
+}
+
+/// Verifies Ethash hash against boundary using the global shared context,
+/// the full one if available for the epoch.
+inline std::error_code verify_against_boundary_global(int epoch_number, const hash256& header_hash,
+    const hash256& mix_hash, uint64_t nonce, const hash256& boundary) noexcept
+{
+    return ethash_verify_against_boundary_global(
+        epoch_number, &header_hash, &mix_hash, nonce, &boundary);
+}
+
+/// Verifies Ethash hash against difficulty using the global shared context,
+/// the full one if available for the epoch.
+inline std::error_code verify_against_difficulty_global(int epoch_number,
+    const hash256& header_hash, const hash256& mix_hash, uint64_t nonce,
+    const hash256& difficulty) noexcept
+{
+    return ethash_verify_against_difficulty_global(
+        epoch_number, &header_hash, &mix_hash, nonce, &difficulty);
+}
+
+/// Verifies Ethash hash against the prepared target using the global shared context,
+/// the full one if available for the epoch.
+inline std::error_code verify_against_target_global(int epoch_number, const hash256& header_hash,
+    const hash256& mix_hash, uint64_t nonce, const prepared_target& t) noexcept
+{
+    return ethash_verify_against_target_global(epoch_number, &header_hash, &mix_hash, nonce, &t);
+}
+
+/// Verifies the Ethash seal of the RLP-encoded block header using the global shared context.
+/// See ethash_verify_header_global().
+inline std::error_code verify_header_global(const uint8_t* header, size_t header_size) noexcept
+{
+    return ethash_verify_header_global(header, header_size);
+}
+
+/// Verifies a batch of header seals using multiple threads. See ethash_verify_batch().
+inline std::vector<ethash_errc> verify_batch(
+    const std::vector<header_seal>& seals, int num_threads = 0)
+{
+    std::vector<ethash_errc> results(seals.size());
+    ethash_verify_batch(seals.data(), seals.size(), results.data(), num_threads);
+    return results;
+}
+
+/// Verifies the header seal asynchronously. See ethash_verify_async().
+///
+/// @return  The future of the verification result. If the request has been rejected
+///          the future is ready with std::errc::resource_unavailable_try_again.
+inline std::future<std::error_code> verify_async(const header_seal& seal)
+{
+    using promise_type = std::promise<std::error_code>;
+
+    auto promise = std::make_unique<promise_type>();
+    auto future = promise->get_future();
+    const auto callback = [](const header_seal*, ethash_errc ec, void* user_data) noexcept {
+        std::unique_ptr<promise_type>{static_cast<promise_type*>(user_data)}->set_value(ec);
+    };
+    if (ethash_verify_async(&seal, callback, promise.get()))
+        promise.release();  // Owned by the callback now.
+    else
+        promise->set_value(make_error_code(std::errc::resource_unavailable_try_again));
+    return future;
 }
 }  // namespace ethash
@@ -0,0 +1,159 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The Ethash hashing kernel parametrized with the full dataset lookup policy.
+///
+/// The lookup policy is a callable object with the signature
+/// `hash1024 lookup(const epoch_context& context, uint32_t index)` returning the full dataset
+/// item of the given index (the same bytes calculate_dataset_item_1024() would return).
+/// Because the policy is a template parameter, the lookup is inlined into the kernel loop
+/// so custom dataset backends (e.g. partial caches or memory-mapped files) can be plugged in
+/// without paying for an indirect call per dataset access.
+
+#pragma once
+
+#include <ethash/ethash.hpp>
+#include <ethash/keccak.hpp>
+#include <cstring>
+
+#ifndef __has_cpp_attribute
+#define __has_cpp_attribute(X) 0
+#endif
+
+#if __has_cpp_attribute(clang::no_sanitize)
+#define ETHASH_NO_SANITIZE_UNSIGNED_OVERFLOW [[clang::no_sanitize("unsigned-integer-overflow")]]
+#else
+#define ETHASH_NO_SANITIZE_UNSIGNED_OVERFLOW
+#endif
+
+namespace ethash
+{
+namespace detail
+{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+inline uint32_t le_uint32(uint32_t x) noexcept
+{
+    return __builtin_bswap32(x);
+}
+
+inline uint64_t le_uint64(uint64_t x) noexcept
+{
+    return __builtin_bswap64(x);
+}
+
+template <typename Hash>
+inline Hash le_uint32s(Hash h) noexcept
+{
+    for (auto& w : h.word32s)
+        w = le_uint32(w);
+    return h;
+}
+#else
+inline uint32_t le_uint32(uint32_t x) noexcept
+{
+    return x;
+}
+
+inline uint64_t le_uint64(uint64_t x) noexcept
+{
+    return x;
+}
+
+template <typename Hash>
+inline const Hash& le_uint32s(const Hash& h) noexcept
+{
+    return h;
+}
+#endif
+
+/// The core transformation of the FNV-1 hash function.
+/// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function#FNV-1_hash.
+ETHASH_NO_SANITIZE_UNSIGNED_OVERFLOW inline uint32_t fnv1(uint32_t u, uint32_t v) noexcept
+{
+    static const uint32_t fnv_prime = 0x01000193;
+    return (u * fnv_prime) ^ v;
+}
+
+inline hash512 hash_seed(const hash256& header_hash, uint64_t nonce) noexcept
+{
+    nonce = le_uint64(nonce);
+    uint8_t init_data[sizeof(header_hash) + sizeof(nonce)];
+    std::memcpy(&init_data[0], &header_hash, sizeof(header_hash));
+    std::memcpy(&init_data[sizeof(header_hash)], &nonce, sizeof(nonce));
+
+    return keccak512(init_data, sizeof(init_data));
+}
+
+inline hash256 hash_final(const hash512& seed, const hash256& mix_hash) noexcept
+{
+    uint8_t final_data[sizeof(seed) + sizeof(mix_hash)];
+    std::memcpy(&final_data[0], seed.bytes, sizeof(seed));
+    std::memcpy(&final_data[sizeof(seed)], mix_hash.bytes, sizeof(mix_hash));
+    return keccak256(final_data, sizeof(final_data));
+}
+}  // namespace detail
+
+/// The lookup policy computing the full dataset items from the light cache.
+///
+/// The item calculation itself is not inlined, it is the call to the library function
+/// calculate_dataset_item_1024().
+struct light_lookup
+{
+    hash1024 operator()(const epoch_context& context, uint32_t index) const noexcept
+    {
+        return calculate_dataset_item_1024(context, index);
+    }
+};
+
+/// Computes the Ethash mix hash out of the seed using the provided dataset lookup policy.
+template <typename Lookup>
+inline hash256 hash_kernel(
+    const epoch_context& context, const hash512& seed, const Lookup& lookup) noexcept
+{
+    using detail::fnv1;
+    using detail::le_uint32;
+    using detail::le_uint32s;
+
+    static constexpr size_t num_words = sizeof(hash1024) / sizeof(uint32_t);
+    const uint32_t index_limit = static_cast<uint32_t>(context.full_dataset_num_items);
+    const uint32_t seed_init = le_uint32(seed.word32s[0]);
+
+    hash1024 mix{{le_uint32s(seed), le_uint32s(seed)}};
+
+    for (uint32_t i = 0; i < num_dataset_accesses; ++i)
+    {
+        const uint32_t p = fnv1(i ^ seed_init, mix.word32s[i % num_words]) % index_limit;
+        const hash1024 newdata = le_uint32s(lookup(context, p));
+
+        for (size_t j = 0; j < num_words; ++j)
+            mix.word32s[j] = fnv1(mix.word32s[j], newdata.word32s[j]);
+    }
+
+    hash256 mix_hash;
+    for (size_t i = 0; i < num_words; i += 4)
+    {
+        const uint32_t h1 = fnv1(mix.word32s[i], mix.word32s[i + 1]);
+        const uint32_t h2 = fnv1(h1, mix.word32s[i + 2]);
+        const uint32_t h3 = fnv1(h2, mix.word32s[i + 3]);
+        mix_hash.word32s[i / 4] = h3;
+    }
+
+    return le_uint32s(mix_hash);
+}
+
+/// Computes Ethash hash using the provided dataset lookup policy.
+///
+/// The result is identical to hash() as long as the lookup policy returns correct
+/// full dataset items.
+template <typename Lookup>
+inline result hash(const epoch_context& context, const hash256& header_hash, uint64_t nonce,
+    const Lookup& lookup) noexcept
+{
+    const hash512 seed = detail::hash_seed(header_hash, nonce);
+    const hash256 mix_hash = hash_kernel(context, seed, lookup);
+    return {detail::hash_final(seed, mix_hash), mix_hash};
+}
+}  // namespace ethash
@@ -17,8 +17,22 @@
 extern "C" {
 #endif
 
+/** The range of bytes, a part of a message hashed with ethash_keccak256_ranges(). */
+struct ethash_bytes_range
+{
+    const uint8_t* data;
+    size_t size;
+};
+
 union ethash_hash256 ethash_keccak256(const uint8_t* data, size_t size) noexcept;
 union ethash_hash256 ethash_keccak256_32(const uint8_t data[32]) noexcept;
+
+/**
+ * Computes Keccak-256 of the concatenation of the byte ranges without copying them.
+ */
+union ethash_hash256 ethash_keccak256_ranges(
+    const struct ethash_bytes_range* ranges, size_t num_ranges) noexcept;
+
 union ethash_hash512 ethash_keccak512(const uint8_t* data, size_t size) noexcept;
 union ethash_hash512 ethash_keccak512_64(const uint8_t data[64]) noexcept;
 
@@ -0,0 +1,89 @@
+/* ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+ * Copyright 2018-2019 Pawel Bylica.
+ * Licensed under the Apache License, Version 2.0.
+ */
+
+#pragma once
+
+#include <ethash/ethash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The phases of the Ethash computation instrumented in the profiling mode.
+ *
+ * The phases may be nested: the dataset lookups include the light cache parent reads
+ * of the items they compute, the mixing includes the lookups.
+ */
+enum ethash_profiling_phase
+{
+    /** The keccak of the header hash and the nonce. */
+    ETHASH_PROFILING_SEED_KECCAK = 0,
+
+    /** The whole dataset access loop of the hashimoto, including the lookups. */
+    ETHASH_PROFILING_MIX = 1,
+
+    /**
+     * The FNV mixing of the dataset access loop: the mixing time minus the lookups time.
+     * This is only computed in the snapshot.
+     */
+    ETHASH_PROFILING_FNV_MIX = 2,
+
+    /** The lookups of the full dataset items already generated (or found in the item cache). */
+    ETHASH_PROFILING_LOOKUP_READY = 3,
+
+    /** The lookups of the full dataset items generated lazily on the first access. */
+    ETHASH_PROFILING_LOOKUP_LAZY = 4,
+
+    /** The lookups of the dataset items computed from the light cache in light hashing. */
+    ETHASH_PROFILING_LOOKUP_COMPUTED = 5,
+
+    /** The keccak of the seed and the mix hash. */
+    ETHASH_PROFILING_FINAL_KECCAK = 6,
+
+    /** The light cache parent reads of dataset item computations, an event per parent read. */
+    ETHASH_PROFILING_LIGHT_CACHE_PARENTS = 7,
+
+    /** The initial sequential keccak of the light cache build. */
+    ETHASH_PROFILING_LIGHT_CACHE_INIT = 8,
+
+    /** The rounds of the light cache build. */
+    ETHASH_PROFILING_LIGHT_CACHE_ROUND_1 = 9,
+    ETHASH_PROFILING_LIGHT_CACHE_ROUND_2 = 10,
+    ETHASH_PROFILING_LIGHT_CACHE_ROUND_3 = 11,
+
+    ETHASH_PROFILING_NUM_PHASES = 12
+};
+
+struct ethash_profiling_counter
+{
+    /** The number of cycles (CPU timestamp ticks, or nanoseconds where not available). */
+    uint64_t cycles;
+
+    /** The number of occurrences. */
+    uint64_t events;
+};
+
+/** The profiling counters, indexed by ethash_profiling_phase. */
+struct ethash_profiling_snapshot
+{
+    struct ethash_profiling_counter phases[ETHASH_PROFILING_NUM_PHASES];
+};
+
+/**
+ * Checks if the library has been built with the profiling mode (ETHASH_ENABLE_PROFILING).
+ * Otherwise the counters are always zero.
+ */
+bool ethash_profiling_enabled() noexcept;
+
+/** Returns the profiling counters of the calling thread. */
+struct ethash_profiling_snapshot ethash_profiling_get_snapshot() noexcept;
+
+/** Resets the profiling counters of the calling thread. */
+void ethash_profiling_reset() noexcept;
+
+#ifdef __cplusplus
+}
+#endif
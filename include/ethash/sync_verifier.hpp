@@ -0,0 +1,56 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+#pragma once
+
+#include <ethash/ethash.hpp>
+
+#include <future>
+#include <map>
+#include <mutex>
+
+namespace ethash
+{
+/// The verifier of long ranges of block headers, e.g. during the historical sync.
+///
+/// The headers are expected to come in (roughly) ascending block order. When the first header
+/// of an epoch is verified, the light cache of the next epoch is built on a background thread,
+/// so the verification does not stall at epoch boundaries. The contexts of epochs older than
+/// the previous one are released.
+///
+/// The verify() method can be called from multiple threads concurrently.
+class sync_verifier
+{
+public:
+    using context_ptr = std::shared_ptr<const epoch_context>;
+
+    sync_verifier() noexcept = default;
+
+    sync_verifier(const sync_verifier&) = delete;
+    sync_verifier& operator=(const sync_verifier&) = delete;
+
+    /// Verifies the header seal against its difficulty.
+    ///
+    /// @return  The ethash_errc verification result, ::ETHASH_INVALID_EPOCH_NUMBER if the block
+    ///          number is out of the supported range or ::ETHASH_OUT_OF_MEMORY if the epoch
+    ///          context could not be created. These two compare equal to
+    ///          std::errc::invalid_argument and std::errc::not_enough_memory respectively.
+    std::error_code verify(const header_seal& seal) noexcept;
+
+    /// Gets the light context for the given epoch, building it if needed.
+    ///
+    /// This also schedules building the context of the next epoch in the background.
+    /// @return  The context or null in case of invalid epoch number or memory allocation failure.
+    context_ptr get_context(int epoch_number) noexcept;
+
+private:
+    using context_future = std::shared_future<context_ptr>;
+
+    /// Gets the context future or starts building the context. Requires the mutex to be locked.
+    context_future& get_or_build(int epoch_number);
+
+    std::mutex m_mutex;
+    std::map<int, context_future> m_contexts;
+    int m_latest_epoch = -1;
+};
+}  // namespace ethash
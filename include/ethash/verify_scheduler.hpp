@@ -0,0 +1,98 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+#pragma once
+
+#include <ethash/global_context.hpp>
+
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace ethash
+{
+/// The scheduler of header seal verifications with priority classes.
+///
+/// The verifications are run by the worker threads of the scheduler using the global shared
+/// contexts. Each priority class has its own lock-free multi-producer queue, so submitting never
+/// blocks. Before each header the workers take the oldest request of the most urgent non-empty
+/// class. Therefore a new head block only waits for the headers already being verified,
+/// not for the whole historical backlog.
+///
+/// The submit() and verify() methods can be called from multiple threads concurrently.
+class verify_scheduler
+{
+public:
+    /// The priority classes, from the most urgent.
+    enum priority : int
+    {
+        /// The new head blocks.
+        head = 0,
+
+        /// The historical headers, e.g. during the sync.
+        backlog = 1,
+    };
+
+    static constexpr int num_priorities = 2;
+
+    /// The callback receiving the verification result. It is invoked on a worker thread
+    /// and must not throw: an exception escaping it calls std::terminate().
+    using callback = std::function<void(const header_seal& seal, std::error_code ec)>;
+
+    /// The latency statistics of a priority class.
+    struct class_stats
+    {
+        /// The number of submitted verifications.
+        uint64_t submitted;
+
+        /// The number of completed verifications.
+        uint64_t completed;
+
+        /// The cumulative time the completed verifications waited in the queue in nanoseconds.
+        uint64_t total_queue_time_ns;
+
+        /// The cumulative time from the submission to the result in nanoseconds.
+        uint64_t total_latency_ns;
+
+        /// The maximum time from the submission to the result in nanoseconds.
+        uint64_t max_latency_ns;
+    };
+
+    /// Starts the worker threads.
+    ///
+    /// @param num_threads  The number of worker threads. Values <= 0 select the number
+    ///                     of hardware threads.
+    /// @throws std::system_error if the threads cannot be started.
+    explicit verify_scheduler(int num_threads = 0);
+
+    /// Stops the worker threads after all the submitted verifications are completed.
+    ~verify_scheduler() noexcept;
+
+    verify_scheduler(const verify_scheduler&) = delete;
+    verify_scheduler& operator=(const verify_scheduler&) = delete;
+
+    /// Submits the header seal for verification against its difficulty.
+    ///
+    /// The verification uses the global shared contexts, the full one if it has already been
+    /// built. The callback receives the ethash_errc verification result,
+    /// ::ETHASH_INVALID_EPOCH_NUMBER if the block number is out of the supported range or
+    /// ::ETHASH_OUT_OF_MEMORY if the epoch context could not be created. These two compare equal
+    /// to std::errc::invalid_argument and std::errc::not_enough_memory respectively.
+    /// The callback must not throw, see callback.
+    /// @return  False if the priority is not one of the priority classes or in case of memory
+    ///          allocation failure. The callback is not invoked then.
+    bool submit(const header_seal& seal, priority p, callback cb) noexcept;
+
+    /// Submits the header seal for verification and returns the future of the result.
+    /// See submit(). The result is std::errc::invalid_argument if the priority is not one of
+    /// the priority classes.
+    std::future<std::error_code> verify(const header_seal& seal, priority p);
+
+    /// Gets the latency statistics of the priority class, zeros for an invalid priority.
+    class_stats get_stats(priority p) const noexcept;
+
+private:
+    struct state;
+    std::unique_ptr<state> m_state;
+};
+}  // namespace ethash
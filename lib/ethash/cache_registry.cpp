@@ -0,0 +1,135 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "cache_registry.hpp"
+#include "item_cache.hpp"
+#include "seal_cache.hpp"
+#include <mutex>
+
+namespace ethash
+{
+namespace
+{
+/// The records. These are never freed, so the lock-free readers can always access them.
+context_caches records[max_contexts_with_caches];
+
+/// The number of records in use. The readers skip the search when 0.
+std::atomic<size_t> num_used_records{0};
+
+/// The number of leading records ever used. The readers search only these.
+std::atomic<size_t> num_searched_records{0};
+
+/// Serializes the writers.
+std::mutex registry_mutex;
+
+/// Checks if the record belongs to the context, not only to the context at the same address.
+inline bool matches(const context_caches& r, const ethash_epoch_context* context) noexcept
+{
+    return r.epoch_number.load(std::memory_order_relaxed) == context->epoch_number &&
+           r.light_cache.load(std::memory_order_relaxed) == context->light_cache;
+}
+
+/// Finds the record of the context address. The record might be stale, see matches().
+inline context_caches* find_address(const ethash_epoch_context* context) noexcept
+{
+    const size_t n = num_searched_records.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (records[i].context.load(std::memory_order_acquire) == context)
+            return &records[i];
+    }
+    return nullptr;
+}
+
+inline context_caches* find(const ethash_epoch_context* context) noexcept
+{
+    auto* const r = find_address(context);
+    return (r != nullptr && matches(*r, context)) ? r : nullptr;
+}
+
+/// Takes the caches out of the record to be destroyed outside of the lock.
+inline void take_caches(
+    context_caches& r, item_cache*& dataset_item_cache, seal_cache*& verified_seal_cache) noexcept
+{
+    dataset_item_cache = r.dataset_item_cache.exchange(nullptr, std::memory_order_acquire);
+    verified_seal_cache = r.verified_seal_cache.exchange(nullptr, std::memory_order_acquire);
+}
+}  // namespace
+
+const context_caches* find_context_caches(const ethash_epoch_context* context) noexcept
+{
+    if (num_used_records.load(std::memory_order_acquire) == 0)
+        return nullptr;
+    return find(context);
+}
+
+context_caches* add_context_caches(const ethash_epoch_context* context) noexcept
+{
+    item_cache* stale_item_cache = nullptr;
+    seal_cache* stale_seal_cache = nullptr;
+    context_caches* record = nullptr;
+    {
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        if (auto* const existing = find_address(context))
+        {
+            if (matches(*existing, context))
+                return existing;
+
+            // The previous context at this address has been freed without removing its record.
+            // Hide the record from the lookups while switching it to the new context.
+            existing->context.store(nullptr, std::memory_order_release);
+            take_caches(*existing, stale_item_cache, stale_seal_cache);
+            record = existing;
+        }
+        else
+        {
+            for (size_t i = 0; i < max_contexts_with_caches; ++i)
+            {
+                auto& r = records[i];
+                if (r.context.load(std::memory_order_relaxed) != nullptr)
+                    continue;
+
+                if (i >= num_searched_records.load(std::memory_order_relaxed))
+                    num_searched_records.store(i + 1, std::memory_order_release);
+                num_used_records.fetch_add(1, std::memory_order_release);
+                record = &r;
+                break;
+            }
+        }
+
+        if (record != nullptr)
+        {
+            // The caches of the removed record have been reset, publish the context.
+            record->epoch_number.store(context->epoch_number, std::memory_order_relaxed);
+            record->light_cache.store(context->light_cache, std::memory_order_relaxed);
+            record->context.store(context, std::memory_order_release);
+        }
+    }
+    destroy_item_cache(stale_item_cache);
+    destroy_seal_cache(stale_seal_cache);
+    return record;
+}
+
+void remove_context_caches(const ethash_epoch_context* context) noexcept
+{
+    if (num_used_records.load(std::memory_order_acquire) == 0)
+        return;
+
+    item_cache* dataset_item_cache = nullptr;
+    seal_cache* verified_seal_cache = nullptr;
+    {
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        // Also the stale record of a previous context at this address is removed.
+        auto* const r = find_address(context);
+        if (r == nullptr)
+            return;
+
+        r->context.store(nullptr, std::memory_order_release);
+        take_caches(*r, dataset_item_cache, verified_seal_cache);
+        num_used_records.fetch_sub(1, std::memory_order_release);
+    }
+    destroy_item_cache(dataset_item_cache);
+    destroy_seal_cache(verified_seal_cache);
+}
+}  // namespace ethash
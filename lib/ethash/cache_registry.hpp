@@ -0,0 +1,60 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The registry of the caches attached to epoch contexts.
+
+#pragma once
+
+#include <ethash/ethash.h>
+#include <atomic>
+#include <cstddef>
+
+namespace ethash
+{
+struct item_cache;
+struct seal_cache;
+
+/// The caches attached to an epoch context.
+///
+/// The records are kept in the memory of the library, not next to the context, because
+/// the ethash_epoch_context can also be created by the library users. The library never reads
+/// the context memory beyond the public fields.
+///
+/// A record is identified by the context address together with its epoch number and light cache
+/// pointer. A context freed without ethash_destroy_epoch_context() leaves its record behind, so
+/// a new context allocated at the same address must not inherit the caches of the old epoch.
+struct context_caches
+{
+    /// The context the caches are attached to, null for a free record.
+    std::atomic<const ethash_epoch_context*> context;
+
+    /// The epoch number of the context.
+    std::atomic<int> epoch_number;
+
+    /// The light cache of the context.
+    std::atomic<const ethash_hash512*> light_cache;
+
+    std::atomic<item_cache*> dataset_item_cache;
+    std::atomic<seal_cache*> verified_seal_cache;
+};
+
+/// The maximum number of contexts having caches attached at the same time.
+constexpr size_t max_contexts_with_caches = 64;
+
+/// Finds the caches attached to the context. Lock-free, the check is a single atomic load
+/// when no context has caches attached.
+///
+/// @return  The record or null if the context has no caches attached.
+const context_caches* find_context_caches(const ethash_epoch_context* context) noexcept;
+
+/// Finds the record of the context or adds the empty one. The stale record left by a freed
+/// context at the same address is reused, its caches are destroyed.
+///
+/// @return  The record or null if the registry is full.
+context_caches* add_context_caches(const ethash_epoch_context* context) noexcept;
+
+/// Removes the record of the context address and destroys the caches attached to it.
+void remove_context_caches(const ethash_epoch_context* context) noexcept;
+}  // namespace ethash
@@ -0,0 +1,47 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The upper bounds of the epoch sizes.
+///
+/// Depends only on the ethash.h constants so it can be used by the build-time epoch tables
+/// generator which is not linked with the ethash library.
+
+#pragma once
+
+#include <ethash/ethash.h>
+
+namespace ethash
+{
+// Internal constants:
+constexpr static int light_cache_init_size = 1 << 24;
+constexpr static int light_cache_growth = 1 << 17;
+constexpr static int full_dataset_init_size = 1 << 30;
+constexpr static int full_dataset_growth = 1 << 23;
+
+static_assert(light_cache_init_size % ETHASH_LIGHT_CACHE_ITEM_SIZE == 0,
+    "light_cache_init_size not multiple of item size");
+static_assert(light_cache_growth % ETHASH_LIGHT_CACHE_ITEM_SIZE == 0,
+    "light_cache_growth not multiple of item size");
+static_assert(full_dataset_init_size % ETHASH_FULL_DATASET_ITEM_SIZE == 0,
+    "full_dataset_init_size not multiple of item size");
+static_assert(full_dataset_growth % ETHASH_FULL_DATASET_ITEM_SIZE == 0,
+    "full_dataset_growth not multiple of item size");
+
+/// Returns the upper bound of the number of light cache items. The actual number of items
+/// is the largest prime not greater than this bound.
+inline constexpr int light_cache_num_items_upper_bound(int epoch_number) noexcept
+{
+    return light_cache_init_size / ETHASH_LIGHT_CACHE_ITEM_SIZE +
+           epoch_number * (light_cache_growth / ETHASH_LIGHT_CACHE_ITEM_SIZE);
+}
+
+/// Returns the upper bound of the number of full dataset items. The actual number of items
+/// is the largest prime not greater than this bound.
+inline constexpr int full_dataset_num_items_upper_bound(int epoch_number) noexcept
+{
+    return full_dataset_init_size / ETHASH_FULL_DATASET_ITEM_SIZE +
+           epoch_number * (full_dataset_growth / ETHASH_FULL_DATASET_ITEM_SIZE);
+}
+}  // namespace ethash
@@ -0,0 +1,148 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The build-time generator of the epoch tables.
+///
+/// The sizes: the number of light cache items and the number of full dataset items of an epoch
+/// are the largest primes not greater than the upper bounds (even numbers) growing linearly with
+/// the epoch number. The table keeps the distance to the prime as a single byte
+/// d = (upper_bound - 1 - prime) / 2, so the sizes of all epochs take 64 KB in total.
+///
+/// The seeds: the seed of every epoch_seed_checkpoint_interval-th epoch, and the index
+/// of the epochs by the first 32-bit word of their seeds. The index is the list of epochs sorted
+/// by the seed words, split into buckets by the top bits of the words.
+
+#include "epoch_bounds.hpp"
+#include "primes.h"
+#include <ethash/keccak.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+constexpr int epoch_seed_checkpoint_interval = 32;
+constexpr int epoch_seed_index_bucket_bits = 13;
+
+constexpr int num_epochs = ETHASH_MAX_EPOCH_NUMBER + 1;
+
+bool write_deltas(std::FILE* out, const char* name, int (*upper_bound)(int) noexcept)
+{
+    std::fprintf(out, "constexpr uint8_t %s[%d] = {", name, num_epochs);
+    for (int epoch_number = 0; epoch_number < num_epochs; ++epoch_number)
+    {
+        const int bound = upper_bound(epoch_number);
+        const int prime = ethash_find_largest_prime(bound);
+        const int distance = bound - 1 - prime;
+        if (bound % 2 != 0 || distance % 2 != 0 || distance / 2 > 0xff)
+        {
+            std::fprintf(stderr, "%s: epoch %d does not fit the table\n", name, epoch_number);
+            return false;
+        }
+
+        std::fprintf(out, "%s%d,", epoch_number % 16 == 0 ? "\n    " : " ", distance / 2);
+    }
+    std::fprintf(out, "\n};\n\n");
+    return true;
+}
+
+void write_seeds(std::FILE* out)
+{
+    std::vector<uint32_t> seed_words(num_epochs);
+
+    std::fprintf(out, "constexpr int epoch_seed_checkpoint_interval = %d;\n\n",
+        epoch_seed_checkpoint_interval);
+    std::fprintf(out, "constexpr uint8_t epoch_seed_checkpoints[%d][32] = {\n",
+        (num_epochs + epoch_seed_checkpoint_interval - 1) / epoch_seed_checkpoint_interval);
+
+    ethash::hash256 seed{};
+    for (int epoch_number = 0; epoch_number < num_epochs; ++epoch_number)
+    {
+        if (epoch_number % epoch_seed_checkpoint_interval == 0)
+        {
+            std::fprintf(out, "    {");
+            for (const auto b : seed.bytes)
+                std::fprintf(out, "0x%02x,", b);
+            std::fprintf(out, "},\n");
+        }
+
+        // The first word of the seed in little-endian order, independent of the build machine.
+        seed_words[static_cast<size_t>(epoch_number)] =
+            uint32_t{seed.bytes[0]} | uint32_t{seed.bytes[1]} << 8 |
+            uint32_t{seed.bytes[2]} << 16 | uint32_t{seed.bytes[3]} << 24;
+        seed = ethash::keccak256(seed);
+    }
+    std::fprintf(out, "};\n\n");
+
+    // Sort the epochs by the seed words. The stable sort keeps the lower epoch first
+    // in the unlikely case of equal words.
+    std::vector<uint16_t> epochs(num_epochs);
+    for (size_t i = 0; i < epochs.size(); ++i)
+        epochs[i] = static_cast<uint16_t>(i);
+    std::stable_sort(epochs.begin(), epochs.end(),
+        [&](uint16_t a, uint16_t b) noexcept { return seed_words[a] < seed_words[b]; });
+
+    constexpr int num_buckets = 1 << epoch_seed_index_bucket_bits;
+    std::fprintf(out, "constexpr int epoch_seed_index_bucket_bits = %d;\n\n",
+        epoch_seed_index_bucket_bits);
+    std::fprintf(out, "constexpr uint32_t epoch_seed_words[%d] = {", num_epochs);
+    for (int i = 0; i < num_epochs; ++i)
+        std::fprintf(out, "%s0x%08x,", i % 8 == 0 ? "\n    " : " ",
+            seed_words[static_cast<size_t>(i)]);
+    std::fprintf(out, "\n};\n\n");
+
+    std::fprintf(out, "constexpr uint16_t epoch_seed_index_buckets[%d] = {", num_buckets + 1);
+    size_t pos = 0;
+    for (int bucket = 0; bucket <= num_buckets; ++bucket)
+    {
+        while (pos < epochs.size() &&
+               (seed_words[epochs[pos]] >> (32 - epoch_seed_index_bucket_bits)) <
+                   static_cast<uint32_t>(bucket))
+            ++pos;
+        std::fprintf(out, "%s%d,", bucket % 16 == 0 ? "\n    " : " ", static_cast<int>(pos));
+    }
+    std::fprintf(out, "\n};\n\n");
+
+    std::fprintf(out, "constexpr uint16_t epoch_seed_index[%d] = {", num_epochs);
+    for (size_t i = 0; i < epochs.size(); ++i)
+        std::fprintf(out, "%s%d,", i % 16 == 0 ? "\n    " : " ", epochs[i]);
+    std::fprintf(out, "\n};\n\n");
+}
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "Usage: %s OUTPUT_FILE\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::FILE* const out = std::fopen(argv[1], "w");
+    if (out == nullptr)
+    {
+        std::perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::fprintf(out,
+        "// Generated by epoch_tables_generator.cpp. Do not edit.\n\n"
+        "#pragma once\n\n"
+        "#include <cstdint>\n\n"
+        "namespace ethash\n"
+        "{\n"
+        "// The number of items of the epoch e is upper_bound(e) - 1 - 2 * deltas[e].\n");
+
+    const bool ok = write_deltas(out, "light_cache_num_items_deltas",
+                        ethash::light_cache_num_items_upper_bound) &&
+                    write_deltas(out, "full_dataset_num_items_deltas",
+                        ethash::full_dataset_num_items_upper_bound);
+    if (ok)
+        write_seeds(out);
+
+    std::fprintf(out, "}  // namespace ethash\n");
+    return (std::fclose(out) == 0 && ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -9,13 +9,21 @@
 #pragma once
 
 #include "endianness.hpp"
+#include "epoch_bounds.hpp"
 #include <ethash/ethash.hpp>
-
+#include <atomic>
 
 extern "C" struct ethash_epoch_context_full : ethash_epoch_context
 {
     ethash_hash1024* full_dataset;
 
+    /// The number of full dataset items generated by ethash_generate_full_dataset_items().
+    /// The items already generated before are not counted.
+    mutable std::atomic<int> num_generated_items{0};
+
+    /// All the full dataset items are generated, the lookups skip the lazy generation check.
+    mutable std::atomic<bool> full_dataset_generated{false};
+
     constexpr ethash_epoch_context_full(int epoch, int light_num_items, const ethash_hash512* light,
         int dataset_num_items, ethash_hash1024* dataset) noexcept
       : ethash_epoch_context{epoch, light_num_items, light, dataset_num_items},
@@ -47,6 +55,19 @@ inline bool equal(const hash256& a, const hash256& b) noexcept
 
 bool check_against_difficulty(const hash256& final_hash, const hash256& difficulty) noexcept;
 
-hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t index) noexcept;
+/// Creates the epoch context with the full dataset which uses the light cache of the given
+/// context instead of its own copy. The given context must outlive the created one.
+epoch_context_full* create_epoch_context_full_sharing_light_cache(
+    const epoch_context& context) noexcept;
+
+/// Checks if final_hash <= target.boundary. The most significant words decide in most cases,
+/// the remaining words are compared only if these are equal.
+inline bool is_within_target(const ethash_target& target, const hash256& final_hash) noexcept
+{
+    const uint64_t top_word = be::uint64(final_hash.word64s[0]);
+    if (top_word != target.boundary_top_word)
+        return top_word < target.boundary_top_word;
+    return less_equal(final_hash, target.boundary);
+}
 
 }  // namespace ethash
@@ -4,19 +4,30 @@
 
 #include "ethash-internal.hpp"
 
+#include "cache_registry.hpp"
+#include "item_cache.hpp"
 #include "primes.h"
+#include "profiling.hpp"
+#include "seal_cache.hpp"
+#include "tracing.hpp"
+#include <ethash/hash_kernel.hpp>
 #include <ethash/keccak.hpp>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#ifdef ETHASH_EPOCH_TABLES
+#include "ethash_epoch_tables.hpp"
+#endif
+
 namespace ethash
 {
 // Internal constants:
-constexpr static int light_cache_init_size = 1 << 24;
-constexpr static int light_cache_growth = 1 << 17;
 constexpr static int light_cache_rounds = 3;
-constexpr static int full_dataset_init_size = 1 << 30;
-constexpr static int full_dataset_growth = 1 << 23;
 constexpr static int full_dataset_item_parents = 256;
 
 // Verify constants:
@@ -28,15 +39,7 @@ static_assert(full_dataset_item_size == ETHASH_FULL_DATASET_ITEM_SIZE, "");
 
 namespace
 {
-/// The core transformation of the FNV-1 hash function.
-/// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function#FNV-1_hash.
-[[clang::no_sanitize("unsigned-integer-overflow")]] inline uint32_t fnv1(
-    uint32_t u, uint32_t v) noexcept
-{
-    static const uint32_t fnv_prime = 0x01000193;
-    return (u * fnv_prime) ^ v;
-}
-
+using detail::fnv1;
 
 inline hash512 fnv1(const hash512& u, const hash512& v) noexcept
 {
@@ -55,6 +58,21 @@ inline hash512 bitwise_xor(const hash512& x, const hash512& y) noexcept
 }
 }  // namespace
 
+#ifdef ETHASH_EPOCH_TABLES
+int find_epoch_number(const hash256& seed) noexcept
+{
+    // Look up the first seed word in the precomputed index of the epoch seeds.
+    const uint32_t seed_word = le::uint32(seed.word32s[0]);
+    const uint32_t bucket = seed_word >> (32 - epoch_seed_index_bucket_bits);
+    for (int i = epoch_seed_index_buckets[bucket]; i < epoch_seed_index_buckets[bucket + 1]; ++i)
+    {
+        const int epoch_number = epoch_seed_index[i];
+        if (epoch_seed_words[epoch_number] == seed_word)
+            return epoch_number;
+    }
+    return -1;
+}
+#else
 int find_epoch_number(const hash256& seed) noexcept
 {
     // Thread-local cache of the last search.
@@ -94,21 +112,27 @@ int find_epoch_number(const hash256& seed) noexcept
 
     return -1;
 }
+#endif
 
 namespace
 {
 void build_light_cache(hash512 cache[], int num_items, const hash256& seed) noexcept
 {
-    hash512 item = keccak512(seed.bytes, sizeof(seed));
-    cache[0] = item;
-    for (int i = 1; i < num_items; ++i)
+    ETHASH_TRACE1(light_cache_build_start, num_items);
     {
-        item = keccak512(item);
-        cache[i] = item;
+        ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LIGHT_CACHE_INIT);
+        hash512 item = keccak512(seed.bytes, sizeof(seed));
+        cache[0] = item;
+        for (int i = 1; i < num_items; ++i)
+        {
+            item = keccak512(item);
+            cache[i] = item;
+        }
     }
 
     for (int q = 0; q < light_cache_rounds; ++q)
     {
+        ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LIGHT_CACHE_ROUND_1 + q);
         for (int i = 0; i < num_items; ++i)
         {
             const uint32_t index_limit = static_cast<uint32_t>(num_items);
@@ -123,9 +147,14 @@ void build_light_cache(hash512 cache[], int num_items, const hash256& seed) noex
             cache[i] = keccak512(bitwise_xor(cache[v], cache[w]));
         }
     }
+
+    ETHASH_TRACE1(light_cache_build_end, num_items);
 }
 
-epoch_context_full* create_epoch_context(int epoch_number, bool full) noexcept
+/// Creates the epoch context. The light cache is copied from the light_cache_source if provided,
+/// or only referenced if share_light_cache is set, otherwise it is built.
+epoch_context_full* create_epoch_context(int epoch_number, bool full,
+    const hash512* light_cache_source = nullptr, bool share_light_cache = false) noexcept
 {
     static_assert(sizeof(epoch_context_full) < sizeof(hash512), "epoch_context too big");
     static constexpr size_t context_alloc_size = sizeof(hash512);
@@ -136,21 +165,38 @@ epoch_context_full* create_epoch_context(int epoch_number, bool full) noexcept
     const int light_cache_num_items = calculate_light_cache_num_items(epoch_number);
     const int full_dataset_num_items = calculate_full_dataset_num_items(epoch_number);
     const size_t light_cache_size = get_light_cache_size(light_cache_num_items);
+    const size_t own_light_cache_size = share_light_cache ? 0 : light_cache_size;
     const size_t full_dataset_size =
         full ? static_cast<size_t>(full_dataset_num_items) * sizeof(hash1024) : 0;
 
-    const size_t alloc_size = context_alloc_size + light_cache_size + full_dataset_size;
+    const size_t alloc_size = context_alloc_size + own_light_cache_size + full_dataset_size;
+
+    ETHASH_TRACE2(context_create_start, epoch_number, full);
 
     char* const alloc_data = static_cast<char*>(std::calloc(1, alloc_size));
     if (!alloc_data)
+    {
+        ETHASH_TRACE3(context_create_end, epoch_number, full, static_cast<epoch_context*>(nullptr));
         return nullptr;  // Signal out-of-memory by returning null pointer.
+    }
 
-    hash512* const light_cache = reinterpret_cast<hash512*>(alloc_data + context_alloc_size);
-    const hash256 epoch_seed = calculate_epoch_seed(epoch_number);
-    build_light_cache(light_cache, light_cache_num_items, epoch_seed);
+    const hash512* light_cache = light_cache_source;
+    if (!share_light_cache)
+    {
+        hash512* const own_light_cache =
+            reinterpret_cast<hash512*>(alloc_data + context_alloc_size);
+        if (light_cache_source != nullptr)
+            std::memcpy(own_light_cache, light_cache_source, light_cache_size);
+        else
+        {
+            build_light_cache(
+                own_light_cache, light_cache_num_items, calculate_epoch_seed(epoch_number));
+        }
+        light_cache = own_light_cache;
+    }
 
     hash1024* const full_dataset =
-        full ? reinterpret_cast<hash1024*>(alloc_data + context_alloc_size + light_cache_size) :
+        full ? reinterpret_cast<hash1024*>(alloc_data + context_alloc_size + own_light_cache_size) :
                nullptr;
 
     epoch_context_full* const context = new (alloc_data) epoch_context_full{
@@ -161,10 +207,17 @@ epoch_context_full* create_epoch_context(int epoch_number, bool full) noexcept
         full_dataset,
     };
 
+    ETHASH_TRACE3(context_create_end, epoch_number, full, context);
     return context;
 }
 }  // namespace
 
+epoch_context_full* create_epoch_context_full_sharing_light_cache(
+    const epoch_context& context) noexcept
+{
+    return create_epoch_context(context.epoch_number, true, context.light_cache, true);
+}
+
 /// Calculates a full dataset item.
 ///
 /// This consist of two 512-bit items defined by the Ethash specification, but these items
@@ -186,13 +239,16 @@ hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t inde
     mix0 = le::uint32s(keccak512(mix0));
     mix1 = le::uint32s(keccak512(mix1));
 
-    for (uint32_t j = 0; j < full_dataset_item_parents; ++j)
     {
-        constexpr size_t num_words = sizeof(mix0) / sizeof(uint32_t);
-        const uint32_t t0 = fnv1(seed0 ^ j, mix0.word32s[j % num_words]);
-        const uint32_t t1 = fnv1(seed1 ^ j, mix1.word32s[j % num_words]);
-        mix0 = fnv1(mix0, le::uint32s(cache[t0 % num_cache_items]));
-        mix1 = fnv1(mix1, le::uint32s(cache[t1 % num_cache_items]));
+        ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LIGHT_CACHE_PARENTS, 2 * full_dataset_item_parents);
+        for (uint32_t j = 0; j < full_dataset_item_parents; ++j)
+        {
+            constexpr size_t num_words = sizeof(mix0) / sizeof(uint32_t);
+            const uint32_t t0 = fnv1(seed0 ^ j, mix0.word32s[j % num_words]);
+            const uint32_t t1 = fnv1(seed1 ^ j, mix1.word32s[j % num_words]);
+            mix0 = fnv1(mix0, le::uint32s(cache[t0 % num_cache_items]));
+            mix1 = fnv1(mix1, le::uint32s(cache[t1 % num_cache_items]));
+        }
     }
 
     return hash1024{{keccak512(le::uint32s(mix0)), keccak512(le::uint32s(mix1))}};
@@ -200,68 +256,143 @@ hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t inde
 
 namespace
 {
-using lookup_fn = hash1024 (*)(const epoch_context&, uint32_t);
-
 inline hash512 hash_seed(const hash256& header_hash, uint64_t nonce) noexcept
 {
-    nonce = le::uint64(nonce);
-    uint8_t init_data[sizeof(header_hash) + sizeof(nonce)];
-    std::memcpy(&init_data[0], &header_hash, sizeof(header_hash));
-    std::memcpy(&init_data[sizeof(header_hash)], &nonce, sizeof(nonce));
-
-    return keccak512(init_data, sizeof(init_data));
+    ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_SEED_KECCAK);
+    return detail::hash_seed(header_hash, nonce);
 }
 
-inline hash256 hash_final(const hash512& seed, const hash256& mix_hash)
+inline hash256 hash_final(const hash512& seed, const hash256& mix_hash) noexcept
 {
-    uint8_t final_data[sizeof(seed) + sizeof(mix_hash)];
-    std::memcpy(&final_data[0], seed.bytes, sizeof(seed));
-    std::memcpy(&final_data[sizeof(seed)], mix_hash.bytes, sizeof(mix_hash));
-    return keccak256(final_data, sizeof(final_data));
+    ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_FINAL_KECCAK);
+    return detail::hash_final(seed, mix_hash);
 }
 
-inline hash256 hash_kernel(
-    const epoch_context& context, const hash512& seed, lookup_fn lookup) noexcept
+/// Computes the mix hash with the given lookup policy.
+template <typename Lookup>
+inline hash256 profiled_hash_kernel(
+    const epoch_context& context, const hash512& seed, const Lookup& lookup) noexcept
 {
-    static constexpr size_t num_words = sizeof(hash1024) / sizeof(uint32_t);
-    const uint32_t index_limit = static_cast<uint32_t>(context.full_dataset_num_items);
-    const uint32_t seed_init = le::uint32(seed.word32s[0]);
+    ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_MIX);
+    return hash_kernel(context, seed, lookup);
+}
 
-    hash1024 mix{{le::uint32s(seed), le::uint32s(seed)}};
+/// The lookup policy computing the full dataset items from the light cache.
+struct computed_lookup
+{
+    hash1024 operator()(const epoch_context& context, uint32_t index) const noexcept
+    {
+        ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LOOKUP_COMPUTED);
+        return calculate_dataset_item_1024(context, index);
+    }
+};
 
-    for (uint32_t i = 0; i < num_dataset_accesses; ++i)
+/// The lookup policy generating the full dataset items lazily when hit for the first time.
+struct lazy_full_lookup
+{
+    hash1024 operator()(const epoch_context& context, uint32_t index) const noexcept
     {
-        const uint32_t p = fnv1(i ^ seed_init, mix.word32s[i % num_words]) % index_limit;
-        const hash1024 newdata = le::uint32s(lookup(context, p));
+        hash1024& item = static_cast<const epoch_context_full&>(context).full_dataset[index];
+        if (item.word64s[0] == 0)
+        {
+            ETHASH_TRACE2(dataset_item_lazy, context.epoch_number, index);
+            ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LOOKUP_LAZY);
+            item = calculate_dataset_item_1024(context, index);
+            return item;
+        }
+        ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LOOKUP_READY);
+        return item;
+    }
+};
 
-        for (size_t j = 0; j < num_words; ++j)
-            mix.word32s[j] = fnv1(mix.word32s[j], newdata.word32s[j]);
+/// The lookup policy for the full dataset with all items already generated.
+struct full_lookup
+{
+    hash1024 operator()(const epoch_context& context, uint32_t index) const noexcept
+    {
+        ETHASH_PROFILE_SCOPE(ETHASH_PROFILING_LOOKUP_READY);
+        return static_cast<const epoch_context_full&>(context).full_dataset[index];
     }
+};
 
-    hash256 mix_hash;
-    for (size_t i = 0; i < num_words; i += 4)
+/// The lookup policy using the item cache in front of the light cache.
+struct cached_lookup
+{
+    item_cache& cache;
+    mutable uint64_t num_hits = 0;
+
+    hash1024 operator()(const epoch_context& context, uint32_t index) const noexcept
     {
-        const uint32_t h1 = fnv1(mix.word32s[i], mix.word32s[i + 1]);
-        const uint32_t h2 = fnv1(h1, mix.word32s[i + 2]);
-        const uint32_t h3 = fnv1(h2, mix.word32s[i + 3]);
-        mix_hash.word32s[i / 4] = h3;
+        // The miss is profiled as the computed lookup, including the cache probe.
+        ETHASH_PROFILE_NAMED_SCOPE(lookup_scope, ETHASH_PROFILING_LOOKUP_READY);
+        hash1024 item;
+        if (cache.load(index, item))
+        {
+            ++num_hits;
+            return item;
+        }
+        ETHASH_PROFILE_SET_PHASE(lookup_scope, ETHASH_PROFILING_LOOKUP_COMPUTED);
+        item = calculate_dataset_item_1024(context, index);
+        cache.store(index, item);
+        return item;
     }
+};
 
-    return le::uint32s(mix_hash);
+/// Computes the mix hash out of the light cache, using the item cache if attached to the context.
+inline hash256 hash_kernel_light(const epoch_context& context, const hash512& seed) noexcept
+{
+    const context_caches* const caches = find_context_caches(&context);
+    item_cache* const cache =
+        caches != nullptr ? caches->dataset_item_cache.load(std::memory_order_acquire) : nullptr;
+    if (cache == nullptr)
+        return profiled_hash_kernel(context, seed, computed_lookup{});
+
+    const cached_lookup lookup{*cache};
+    const hash256 mix_hash = profiled_hash_kernel(context, seed, lookup);
+    cache->record(lookup.num_hits, num_dataset_accesses - lookup.num_hits);
+    return mix_hash;
+}
+
+inline bool is_full_dataset_generated(const epoch_context_full& context) noexcept
+{
+    return context.full_dataset_generated.load(std::memory_order_acquire);
+}
+
+/// Computes the mix hash out of the full dataset.
+inline hash256 hash_kernel_full(const epoch_context_full& context, const hash512& seed) noexcept
+{
+    return is_full_dataset_generated(context) ?
+               profiled_hash_kernel(context, seed, full_lookup{}) :
+               profiled_hash_kernel(context, seed, lazy_full_lookup{});
+}
+
+/// Checks the mix hash of the seal, consulting the verified seal cache if attached to
+/// the context. The mix hash is computed out of the full dataset if requested.
+inline ethash_errc verify_mix_hash(const epoch_context& context, const hash256& header_hash,
+    uint64_t nonce, const hash512& seed, const hash256& mix_hash, bool full) noexcept
+{
+    const context_caches* const caches = find_context_caches(&context);
+    seal_cache* const cache =
+        caches != nullptr ? caches->verified_seal_cache.load(std::memory_order_acquire) : nullptr;
+    if (cache != nullptr && cache->contains(header_hash, nonce, mix_hash))
+        return ETHASH_SUCCESS;
+
+    const hash256 expected_mix_hash =
+        full ? hash_kernel_full(static_cast<const epoch_context_full&>(context), seed) :
+               hash_kernel_light(context, seed);
+    if (!equal(expected_mix_hash, mix_hash))
+        return ETHASH_INVALID_MIX_HASH;
+
+    if (cache != nullptr)
+        cache->store(header_hash, nonce, mix_hash);
+    return ETHASH_SUCCESS;
 }
 }  // namespace
 
 result hash(const epoch_context_full& context, const hash256& header_hash, uint64_t nonce) noexcept
 {
-    static const auto lazy_lookup = [](const epoch_context& ctx, uint32_t index) noexcept {
-        hash1024& item = static_cast<const epoch_context_full&>(ctx).full_dataset[index];
-        if (item.word64s[0] == 0)
-            item = calculate_dataset_item_1024(ctx, index);
-        return item;
-    };
-
     const hash512 seed = hash_seed(header_hash, nonce);
-    const hash256 mix_hash = hash_kernel(context, seed, lazy_lookup);
+    const hash256 mix_hash = hash_kernel_full(context, seed);
     return {hash_final(seed, mix_hash), mix_hash};
 }
 
@@ -388,56 +519,457 @@ struct uint128
     const auto high_one = (((p[7] | p[6] | p[5]) == 0) & (p[4] == 1)) != 0;
     return low_zero && high_one;
 }
+
+namespace
+{
+inline int clz(uint64_t x) noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    unsigned long most_significant_bit;
+    _BitScanReverse64(&most_significant_bit, x);
+    return 63 - static_cast<int>(most_significant_bit);
+#elif defined(_MSC_VER) && !defined(__clang__)
+    unsigned long most_significant_bit;
+    if (_BitScanReverse(&most_significant_bit, static_cast<uint32_t>(x >> 32)))
+        return 31 - static_cast<int>(most_significant_bit);
+    _BitScanReverse(&most_significant_bit, static_cast<uint32_t>(x));
+    return 63 - static_cast<int>(most_significant_bit);
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+/// Computes the reciprocal v = floor((2^128 - 1) / d) - 2^64 of the normalized divisor d
+/// (the most significant bit set). This is the Algorithm 2 from "Improved division by invariant
+/// integers" by Niels Möller and Torbjörn Granlund, the initial approximation is computed by
+/// a single 32-bit division instead of a table lookup.
+[[clang::no_sanitize("unsigned-integer-overflow")]] inline uint64_t reciprocal_2by1(
+    uint64_t d) noexcept
+{
+    const uint64_t d9 = d >> 55;
+    const uint64_t v0 = 0x7fd00 / d9;
+
+    const uint64_t d40 = (d >> 24) + 1;
+    const uint64_t v1 = (v0 << 11) - static_cast<uint32_t>((v0 * v0 * d40) >> 40) - 1;
+
+    const uint64_t v2 = (v1 << 13) + ((v1 * (0x1000000000000000 - v1 * d40)) >> 47);
+
+    const uint64_t d0 = d & 1;
+    const uint64_t d63 = (d >> 1) + d0;  // ceil(d / 2)
+    const uint64_t e = ((v2 >> 1) & (0 - d0)) - v2 * d63;
+    const uint64_t v3 = (umul(v2, e).hi >> 1) + (v2 << 31);
+
+    const auto p = umul(v3, d);
+    const uint64_t p_hi = p.hi + (p.lo + d < p.lo);
+    return v3 - p_hi - d;
+}
+
+struct div_result
+{
+    uint64_t quot;
+    uint64_t rem;
+};
+
+/// Divides the 128-bit number (u1, u0) by the normalized divisor d using its reciprocal v.
+/// Requires u1 < d. This is the Algorithm 4 from the Möller-Granlund paper.
+[[clang::no_sanitize("unsigned-integer-overflow")]] inline div_result udivrem_2by1(
+    uint64_t u1, uint64_t u0, uint64_t d, uint64_t v) noexcept
+{
+    auto q = umul(v, u1);
+    q.lo += u0;
+    q.hi += u1 + (q.lo < u0);
+    ++q.hi;
+
+    uint64_t r = u0 - q.hi * d;
+    if (r > q.lo)
+    {
+        --q.hi;
+        r += d;
+    }
+    if (r >= d)
+    {
+        ++q.hi;
+        r -= d;
+    }
+    return {q.hi, r};
+}
+
+/// Computes 2^256 / difficulty using the Knuth's D algorithm with 64-bit words.
+/// The quotient digits are estimated by the 128 / 64 division with the precomputed reciprocal
+/// of the top divisor word.
+[[clang::no_sanitize("unsigned-integer-overflow", "unsigned-shift-base")]] hash256
+calculate_boundary(const hash256& difficulty) noexcept
+{
+    constexpr int num_words = sizeof(hash256) / sizeof(uint64_t);
+
+    // Convert difficulty to little-endian array of native 64-bit words.
+    uint64_t d[num_words];
+    for (int i = 0; i < num_words; ++i)
+        d[i] = be::uint64(difficulty.word64s[num_words - 1 - i]);
+
+    // Find actual divisor size by omitting leading zero words.
+    int n = num_words;
+    while (n > 0 && d[n - 1] == 0)
+        --n;
+
+    // For difficulty of 0 (division by 0) or 1 (256-bit overflow) return max boundary value.
+    if (n == 0 || (n == 1 && d[0] == 1))
+    {
+        return hash256{
+            {0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff}};
+    }
+
+    // Normalize d.
+    uint64_t dn[num_words];
+    const int shift = clz(d[n - 1]);
+    for (int i = n - 1; i > 0; --i)
+        dn[i] = shift != 0 ? (d[i] << shift) | (d[i - 1] >> (64 - shift)) : d[i];
+    dn[0] = d[0] << shift;
+
+    // Normalized 2^256.
+    constexpr int m = num_words + 1;
+    uint64_t un[m + 1]{};  // Requires one more leading word for n != 1 division.
+    un[m - 1] = uint64_t{1} << shift;
+
+    const uint64_t d1 = dn[n - 1];
+    const uint64_t v = reciprocal_2by1(d1);
+
+    uint64_t q[num_words]{};
+
+    if (n == 1)
+    {
+        uint64_t rem = un[m - 1];
+        for (int j = m - 2; j >= 0; --j)
+        {
+            const auto r = udivrem_2by1(rem, un[j], d1, v);
+            q[j] = r.quot;
+            rem = r.rem;
+        }
+    }
+    else
+    {
+        const uint64_t d0 = dn[n - 2];
+        for (int j = m - n; j >= 0; --j)  // Main loop.
+        {
+            const uint64_t u2 = un[j + n];
+            const uint64_t u1 = un[j + n - 1];
+            const uint64_t u0 = un[j + n - 2];
+
+            // Estimate the quotient digit out of the top words.
+            uint64_t qhat = ~uint64_t{0};
+            uint64_t rhat = u1 + d1;
+            bool rhat_overflow = rhat < u1;
+            if (u2 < d1)
+            {
+                const auto r = udivrem_2by1(u2, u1, d1, v);
+                qhat = r.quot;
+                rhat = r.rem;
+                rhat_overflow = false;
+            }
+
+            // Correct the estimate using the second divisor word. Then it's at most one too big.
+            for (int k = 0; k < 2 && !rhat_overflow; ++k)
+            {
+                const auto p = umul(qhat, d0);
+                if (p.hi < rhat || (p.hi == rhat && p.lo <= u0))
+                    break;
+                --qhat;
+                rhat += d1;
+                rhat_overflow = rhat < d1;
+            }
+
+            // Multiply and subtract.
+            uint64_t borrow = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                const auto p = umul(qhat, dn[i]);
+                const uint64_t s = un[i + j] - borrow;
+                const bool k1 = un[i + j] < borrow;
+                const uint64_t t = s - p.lo;
+                const bool k2 = s < p.lo;
+                un[i + j] = t;
+                borrow = p.hi + k1 + k2;
+            }
+            un[j + n] = u2 - borrow;
+
+            if (u2 < borrow)  // Too much subtracted, add back.
+            {
+                --qhat;
+
+                bool carry = false;
+                for (int i = 0; i < n; ++i)
+                {
+                    const uint64_t s1 = un[i + j] + dn[i];
+                    const bool k1 = s1 < un[i + j];
+                    const uint64_t s2 = s1 + carry;
+                    const bool k2 = s2 < s1;
+                    un[i + j] = s2;
+                    carry = k1 || k2;
+                }
+                un[j + n] += carry;
+            }
+
+            q[j] = qhat;  // Store quotient digit.
+        }
+    }
+
+    // Convert to big-endian.
+    hash256 boundary;
+    for (int i = 0; i < num_words; ++i)
+        boundary.word64s[i] = be::uint64(q[num_words - 1 - i]);
+    return boundary;
+}
+}  // namespace
+
+namespace
+{
+/// The positions of the fields of the block header used by Ethash.
+constexpr size_t header_difficulty_index = 7;
+constexpr size_t header_number_index = 8;
+constexpr size_t header_mix_hash_index = 13;
+constexpr size_t header_nonce_index = 14;
+
+/// The highest block number of the supported epochs.
+constexpr uint64_t max_block_number = uint64_t{max_epoch_number + 1} * epoch_length - 1;
+
+/// The RLP item located in the encoded bytes.
+struct rlp_item
+{
+    const uint8_t* payload;
+    size_t payload_size;
+    bool is_list;
+};
+
+/// Reads the big-endian payload length of the long RLP item and advances the position past it.
+/// Rejects non-canonical lengths.
+inline bool read_rlp_length(
+    const uint8_t*& it, const uint8_t* end, size_t length_size, size_t& length) noexcept
+{
+    if (length_size > sizeof(uint32_t) || static_cast<size_t>(end - it) < length_size || *it == 0)
+        return false;
+
+    length = 0;
+    for (size_t i = 0; i < length_size; ++i)
+        length = (length << 8) | *it++;
+    return length >= 56;
+}
+
+/// Decodes the RLP item at the given position and advances the position past the item.
+/// Rejects items exceeding the input and non-canonical encodings.
+inline bool decode_rlp_item(const uint8_t*& it, const uint8_t* end, rlp_item& item) noexcept
+{
+    if (it == end)
+        return false;
+
+    const uint8_t prefix = *it++;
+    if (prefix < 0x80)
+    {
+        item = {it - 1, 1, false};
+        return true;
+    }
+
+    const bool is_list = prefix >= 0xc0;
+    size_t size = 0;
+    if (prefix < 0xb8)
+        size = prefix - size_t{0x80};
+    else if (prefix < 0xc0)
+    {
+        if (!read_rlp_length(it, end, prefix - size_t{0xb7}, size))
+            return false;
+    }
+    else if (prefix < 0xf8)
+        size = prefix - size_t{0xc0};
+    else if (!read_rlp_length(it, end, prefix - size_t{0xf7}, size))
+        return false;
+
+    if (static_cast<size_t>(end - it) < size)
+        return false;
+    if (!is_list && size == 1 && *it < 0x80)
+        return false;  // The single byte must be encoded as itself.
+
+    item = {it, size, is_list};
+    it += size;
+    return true;
+}
+
+/// Copies the RLP-encoded unsigned integer to the big-endian number of the given size.
+/// Rejects lists, too long strings and leading zeros.
+inline bool decode_rlp_uint(const rlp_item& item, uint8_t* out, size_t out_size) noexcept
+{
+    if (item.is_list || item.payload_size > out_size ||
+        (item.payload_size != 0 && item.payload[0] == 0))
+        return false;
+
+    const size_t padding = out_size - item.payload_size;
+    std::memset(out, 0, padding);
+    std::memcpy(out + padding, item.payload, item.payload_size);
+    return true;
+}
+
+/// Encodes the RLP list prefix for the payload of the given size. Returns the prefix size.
+inline size_t encode_rlp_list_prefix(uint8_t out[9], size_t payload_size) noexcept
+{
+    if (payload_size < 56)
+    {
+        out[0] = static_cast<uint8_t>(0xc0 + payload_size);
+        return 1;
+    }
+
+    size_t length_size = 0;
+    for (size_t s = payload_size; s != 0; s >>= 8)
+        ++length_size;
+
+    out[0] = static_cast<uint8_t>(0xf7 + length_size);
+    for (size_t i = length_size; i > 0; --i, payload_size >>= 8)
+        out[i] = static_cast<uint8_t>(payload_size);
+    return length_size + 1;
+}
+
+ethash_errc decode_rlp_header_seal(
+    const uint8_t* header, size_t header_size, header_seal& seal) noexcept
+{
+    const uint8_t* it = header;
+    const uint8_t* const end = header + header_size;
+
+    rlp_item list{};
+    if (!decode_rlp_item(it, end, list) || !list.is_list || it != end)
+        return ETHASH_INVALID_HEADER;
+
+    // The mix hash and the nonce are adjacent, this is the range of bytes excluded from hashing.
+    const uint8_t* seal_begin = nullptr;
+    const uint8_t* seal_end = nullptr;
+
+    it = list.payload;
+    for (size_t index = 0; it != end; ++index)
+    {
+        const uint8_t* const field_begin = it;
+        rlp_item field{};
+        if (!decode_rlp_item(it, end, field))
+            return ETHASH_INVALID_HEADER;
+
+        switch (index)
+        {
+        case header_difficulty_index:
+            if (!decode_rlp_uint(field, seal.difficulty.bytes, sizeof(seal.difficulty)))
+                return ETHASH_INVALID_HEADER;
+            break;
+
+        case header_number_index:
+        {
+            uint8_t number_bytes[sizeof(uint64_t)];
+            if (!decode_rlp_uint(field, number_bytes, sizeof(number_bytes)))
+                return ETHASH_INVALID_HEADER;
+            uint64_t number;
+            std::memcpy(&number, number_bytes, sizeof(number));
+            number = be::uint64(number);
+            if (number > max_block_number)
+                return ETHASH_INVALID_HEADER;
+            seal.block_number = static_cast<int>(number);
+            break;
+        }
+
+        case header_mix_hash_index:
+            if (field.is_list || field.payload_size != sizeof(seal.mix_hash))
+                return ETHASH_INVALID_HEADER;
+            std::memcpy(seal.mix_hash.bytes, field.payload, sizeof(seal.mix_hash));
+            seal_begin = field_begin;
+            break;
+
+        case header_nonce_index:
+            if (field.is_list || field.payload_size != sizeof(seal.nonce))
+                return ETHASH_INVALID_HEADER;
+            std::memcpy(&seal.nonce, field.payload, sizeof(seal.nonce));
+            seal.nonce = be::uint64(seal.nonce);
+            seal_end = it;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (seal_end == nullptr)
+        return ETHASH_INVALID_HEADER;
+
+    uint8_t prefix[9];
+    const size_t seal_size = static_cast<size_t>(seal_end - seal_begin);
+    const size_t prefix_size = encode_rlp_list_prefix(prefix, list.payload_size - seal_size);
+    const ethash_bytes_range ranges[] = {
+        {prefix, prefix_size},
+        {list.payload, static_cast<size_t>(seal_begin - list.payload)},
+        {seal_end, static_cast<size_t>(end - seal_end)},
+    };
+    seal.header_hash = ethash_keccak256_ranges(ranges, sizeof(ranges) / sizeof(ranges[0]));
+    return ETHASH_SUCCESS;
+}
+}  // namespace
 }  // namespace ethash
 
 using namespace ethash;
 
 extern "C" {
 
+#ifdef ETHASH_EPOCH_TABLES
 ethash_hash256 ethash_calculate_epoch_seed(int epoch_number) noexcept
 {
     ethash_hash256 epoch_seed = {};
-    for (int i = 0; i < epoch_number; ++i)
+    if (epoch_number <= 0)
+        return epoch_seed;
+
+    // Start from the nearest precomputed seed.
+    constexpr int last_checkpoint =
+        sizeof(epoch_seed_checkpoints) / sizeof(epoch_seed_checkpoints[0]) - 1;
+    const int checkpoint = std::min(epoch_number / epoch_seed_checkpoint_interval, last_checkpoint);
+    std::memcpy(epoch_seed.bytes, epoch_seed_checkpoints[checkpoint], sizeof(epoch_seed));
+
+    for (int i = checkpoint * epoch_seed_checkpoint_interval; i < epoch_number; ++i)
         epoch_seed = ethash_keccak256_32(epoch_seed.bytes);
     return epoch_seed;
 }
 
 int ethash_calculate_light_cache_num_items(int epoch_number) noexcept
 {
-    constexpr int item_size = sizeof(hash512);
-    constexpr int num_items_init = light_cache_init_size / item_size;
-    constexpr int num_items_growth = light_cache_growth / item_size;
-    static_assert(
-        light_cache_init_size % item_size == 0, "light_cache_init_size not multiple of item size");
-    static_assert(
-        light_cache_growth % item_size == 0, "light_cache_growth not multiple of item size");
-
     if (epoch_number < 0 || epoch_number > max_epoch_number)
         return 0;
 
-    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
-    int num_items = ethash_find_largest_prime(num_items_upper_bound);
-    return num_items;
+    return light_cache_num_items_upper_bound(epoch_number) - 1 -
+           2 * light_cache_num_items_deltas[epoch_number];
 }
 
 int ethash_calculate_full_dataset_num_items(int epoch_number) noexcept
 {
-    constexpr int item_size = sizeof(hash1024);
-    constexpr int num_items_init = full_dataset_init_size / item_size;
-    constexpr int num_items_growth = full_dataset_growth / item_size;
-    static_assert(full_dataset_init_size % item_size == 0,
-        "full_dataset_init_size not multiple of item size");
-    static_assert(
-        full_dataset_growth % item_size == 0, "full_dataset_growth not multiple of item size");
+    if (epoch_number < 0 || epoch_number > max_epoch_number)
+        return 0;
+
+    return full_dataset_num_items_upper_bound(epoch_number) - 1 -
+           2 * full_dataset_num_items_deltas[epoch_number];
+}
+#else
+ethash_hash256 ethash_calculate_epoch_seed(int epoch_number) noexcept
+{
+    ethash_hash256 epoch_seed = {};
+    for (int i = 0; i < epoch_number; ++i)
+        epoch_seed = ethash_keccak256_32(epoch_seed.bytes);
+    return epoch_seed;
+}
 
+int ethash_calculate_light_cache_num_items(int epoch_number) noexcept
+{
     if (epoch_number < 0 || epoch_number > max_epoch_number)
         return 0;
 
-    int num_items_upper_bound = num_items_init + epoch_number * num_items_growth;
-    int num_items = ethash_find_largest_prime(num_items_upper_bound);
-    return num_items;
+    return ethash_find_largest_prime(light_cache_num_items_upper_bound(epoch_number));
 }
 
+int ethash_calculate_full_dataset_num_items(int epoch_number) noexcept
+{
+    if (epoch_number < 0 || epoch_number > max_epoch_number)
+        return 0;
+
+    return ethash_find_largest_prime(full_dataset_num_items_upper_bound(epoch_number));
+}
+#endif
+
 epoch_context* ethash_create_epoch_context(int epoch_number) noexcept
 {
     return create_epoch_context(epoch_number, false);
@@ -448,6 +980,12 @@ epoch_context_full* ethash_create_epoch_context_full(int epoch_number) noexcept
     return create_epoch_context(epoch_number, true);
 }
 
+epoch_context_full* ethash_create_epoch_context_full_from_light(
+    const epoch_context* context) noexcept
+{
+    return create_epoch_context(context->epoch_number, true, context->light_cache);
+}
+
 void ethash_destroy_epoch_context_full(epoch_context_full* context) noexcept
 {
     ethash_destroy_epoch_context(context);
@@ -455,18 +993,132 @@ void ethash_destroy_epoch_context_full(epoch_context_full* context) noexcept
 
 void ethash_destroy_epoch_context(epoch_context* context) noexcept
 {
+    remove_context_caches(context);
     context->~epoch_context();
     std::free(context);
 }
 
+bool ethash_attach_item_cache(const epoch_context* context, size_t size) noexcept
+{
+    item_cache* const cache = create_item_cache(size);
+    if (cache == nullptr)
+        return false;
+
+    context_caches* const caches = add_context_caches(context);
+    item_cache* expected = nullptr;
+    if (caches == nullptr || !caches->dataset_item_cache.compare_exchange_strong(
+                                 expected, cache, std::memory_order_release))
+    {
+        destroy_item_cache(cache);
+        return false;
+    }
+    return true;
+}
+
+ethash_item_cache_stats ethash_get_item_cache_stats(const epoch_context* context) noexcept
+{
+    const context_caches* const caches = find_context_caches(context);
+    const item_cache* const cache =
+        caches != nullptr ? caches->dataset_item_cache.load(std::memory_order_acquire) : nullptr;
+    if (cache == nullptr)
+        return {};
+
+    return {cache->num_hits.load(std::memory_order_relaxed),
+        cache->num_misses.load(std::memory_order_relaxed), cache->capacity()};
+}
+
+bool ethash_attach_seal_cache(const epoch_context* context, size_t size) noexcept
+{
+    seal_cache* const cache = create_seal_cache(size);
+    if (cache == nullptr)
+        return false;
+
+    context_caches* const caches = add_context_caches(context);
+    seal_cache* expected = nullptr;
+    if (caches == nullptr || !caches->verified_seal_cache.compare_exchange_strong(
+                                 expected, cache, std::memory_order_release))
+    {
+        destroy_seal_cache(cache);
+        return false;
+    }
+    return true;
+}
+
+ethash_seal_cache_stats ethash_get_seal_cache_stats(const epoch_context* context) noexcept
+{
+    const context_caches* const caches = find_context_caches(context);
+    const seal_cache* const cache =
+        caches != nullptr ? caches->verified_seal_cache.load(std::memory_order_acquire) : nullptr;
+    if (cache == nullptr)
+        return {};
+
+    return {cache->num_hits.load(std::memory_order_relaxed),
+        cache->num_misses.load(std::memory_order_relaxed), cache->capacity()};
+}
+
+void ethash_generate_full_dataset_items(
+    const epoch_context_full* context, int first, int count) noexcept
+{
+    const int begin = std::max(first, 0);
+    const int end = static_cast<int>(std::min(int64_t{first} + count,
+        int64_t{context->full_dataset_num_items}));
+    if (begin >= end)
+        return;
+
+    int num_new_items = 0;
+    for (int i = begin; i < end; ++i)
+    {
+        hash1024& item = context->full_dataset[i];
+        if (item.word64s[0] == 0)
+        {
+            item = calculate_dataset_item_1024(*context, static_cast<uint32_t>(i));
+            ++num_new_items;
+        }
+    }
+    if (num_new_items == 0)
+        return;
+
+    const int num_generated_items =
+        context->num_generated_items.fetch_add(num_new_items, std::memory_order_acq_rel) +
+        num_new_items;
+    if (num_generated_items < context->full_dataset_num_items)
+        return;
+
+    // Concurrent invocations may have generated and counted the same items, so check that
+    // all the items are in place before the lookups skip the check.
+    for (int i = 0; i < context->full_dataset_num_items; ++i)
+    {
+        hash1024& item = context->full_dataset[i];
+        if (item.word64s[0] == 0)
+            item = calculate_dataset_item_1024(*context, static_cast<uint32_t>(i));
+    }
+    context->full_dataset_generated.store(true, std::memory_order_release);
+}
+
 ethash_result ethash_hash(
     const epoch_context* context, const hash256* header_hash, uint64_t nonce) noexcept
 {
     const hash512 seed = hash_seed(*header_hash, nonce);
-    const hash256 mix_hash = hash_kernel(*context, seed, calculate_dataset_item_1024);
+    const hash256 mix_hash = hash_kernel_light(*context, seed);
     return {hash_final(seed, mix_hash), mix_hash};
 }
 
+ethash_hash256 ethash_difficulty_to_boundary(const ethash_hash256* difficulty) noexcept
+{
+    return calculate_boundary(*difficulty);
+}
+
+ethash_target ethash_prepare_target(const ethash_hash256* difficulty) noexcept
+{
+    const hash256 boundary = calculate_boundary(*difficulty);
+    return {boundary, be::uint64(boundary.word64s[0])};
+}
+
+bool ethash_check_target(const ethash_target* target, const ethash_hash256* final_hash) noexcept
+{
+    return is_within_target(*target, *final_hash);
+}
+
 
 ethash_errc ethash_verify_final_hash_against_difficulty(const hash256* header_hash,
     const hash256* mix_hash, uint64_t nonce, const hash256* difficulty) noexcept
@@ -477,6 +1129,14 @@ ethash_errc ethash_verify_final_hash_against_difficulty(const hash256* header_ha
                ETHASH_INVALID_FINAL_HASH;
 }
 
+ethash_errc ethash_verify_final_hash_against_target(const hash256* header_hash,
+    const hash256* mix_hash, uint64_t nonce, const ethash_target* target) noexcept
+{
+    return is_within_target(*target, hash_final(hash_seed(*header_hash, nonce), *mix_hash)) ?
+               ETHASH_SUCCESS :
+               ETHASH_INVALID_FINAL_HASH;
+}
+
 ethash_errc ethash_verify_against_boundary(const epoch_context* context, const hash256* header_hash,
     const hash256* mix_hash, uint64_t nonce, const hash256* boundary) noexcept
 {
@@ -484,8 +1144,7 @@ ethash_errc ethash_verify_against_boundary(const epoch_context* context, const h
     if (!less_equal(hash_final(seed, *mix_hash), *boundary))
         return ETHASH_INVALID_FINAL_HASH;
 
-    const hash256 expected_mix_hash = hash_kernel(*context, seed, calculate_dataset_item_1024);
-    return equal(expected_mix_hash, *mix_hash) ? ETHASH_SUCCESS : ETHASH_INVALID_MIX_HASH;
+    return verify_mix_hash(*context, *header_hash, nonce, seed, *mix_hash, false);
 }
 
 ethash_errc ethash_verify_against_difficulty(const epoch_context* context,
@@ -496,8 +1155,56 @@ ethash_errc ethash_verify_against_difficulty(const epoch_context* context,
     if (!check_against_difficulty(hash_final(seed, *mix_hash), *difficulty))
         return ETHASH_INVALID_FINAL_HASH;
 
-    const hash256 expected_mix_hash = hash_kernel(*context, seed, calculate_dataset_item_1024);
-    return equal(expected_mix_hash, *mix_hash) ? ETHASH_SUCCESS : ETHASH_INVALID_MIX_HASH;
+    return verify_mix_hash(*context, *header_hash, nonce, seed, *mix_hash, false);
+}
+
+ethash_errc ethash_verify_against_boundary_full(const epoch_context_full* context,
+    const hash256* header_hash, const hash256* mix_hash, uint64_t nonce,
+    const hash256* boundary) noexcept
+{
+    const hash512 seed = hash_seed(*header_hash, nonce);
+    if (!less_equal(hash_final(seed, *mix_hash), *boundary))
+        return ETHASH_INVALID_FINAL_HASH;
+
+    return verify_mix_hash(*context, *header_hash, nonce, seed, *mix_hash, true);
+}
+
+ethash_errc ethash_verify_against_difficulty_full(const epoch_context_full* context,
+    const hash256* header_hash, const hash256* mix_hash, uint64_t nonce,
+    const hash256* difficulty) noexcept
+{
+    const hash512 seed = hash_seed(*header_hash, nonce);
+    if (!check_against_difficulty(hash_final(seed, *mix_hash), *difficulty))
+        return ETHASH_INVALID_FINAL_HASH;
+
+    return verify_mix_hash(*context, *header_hash, nonce, seed, *mix_hash, true);
+}
+
+ethash_errc ethash_verify_against_target(const epoch_context* context, const hash256* header_hash,
+    const hash256* mix_hash, uint64_t nonce, const ethash_target* target) noexcept
+{
+    const hash512 seed = hash_seed(*header_hash, nonce);
+    if (!is_within_target(*target, hash_final(seed, *mix_hash)))
+        return ETHASH_INVALID_FINAL_HASH;
+
+    return verify_mix_hash(*context, *header_hash, nonce, seed, *mix_hash, false);
+}
+
+ethash_errc ethash_verify_against_target_full(const epoch_context_full* context,
+    const hash256* header_hash, const hash256* mix_hash, uint64_t nonce,
+    const ethash_target* target) noexcept
+{
+    const hash512 seed = hash_seed(*header_hash, nonce);
+    if (!is_within_target(*target, hash_final(seed, *mix_hash)))
+        return ETHASH_INVALID_FINAL_HASH;
+
+    return verify_mix_hash(*context, *header_hash, nonce, seed, *mix_hash, true);
+}
+
+ethash_errc ethash_decode_header_seal(
+    const uint8_t* header, size_t header_size, ethash_header_seal* seal) noexcept
+{
+    return decode_rlp_header_seal(header, header_size, *seal);
 }
 
 }  // extern "C"
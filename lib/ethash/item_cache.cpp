@@ -0,0 +1,87 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "item_cache.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace ethash
+{
+bool item_cache::load(uint32_t index, hash1024& item) const noexcept
+{
+    const uint32_t tag = index + 1;
+    const set& s = sets[index % num_sets];
+
+    for (const auto& e : s.slots)
+    {
+        const uint32_t v1 = e.version.load(std::memory_order_acquire);
+        if (e.tag.load(std::memory_order_relaxed) != tag)
+            continue;
+
+        for (size_t i = 0; i < num_words; ++i)
+            item.word64s[i] = e.words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint32_t v2 = e.version.load(std::memory_order_relaxed);
+        return (v1 == v2) && (v1 % 2 == 0);
+    }
+    return false;
+}
+
+void item_cache::store(uint32_t index, const hash1024& item) noexcept
+{
+    set& s = sets[index % num_sets];
+
+    // Pick the empty slot if available, otherwise evict in round-robin order.
+    slot* victim = nullptr;
+    for (auto& e : s.slots)
+    {
+        if (e.tag.load(std::memory_order_relaxed) == 0)
+        {
+            victim = &e;
+            break;
+        }
+    }
+    if (victim == nullptr)
+        victim = &s.slots[s.next_victim.fetch_add(1, std::memory_order_relaxed) % num_ways];
+
+    uint32_t v = victim->version.load(std::memory_order_relaxed);
+    if (v % 2 != 0 ||
+        !victim->version.compare_exchange_strong(v, v + 1, std::memory_order_acquire))
+        return;  // Other writer owns the slot, skip.
+    std::atomic_thread_fence(std::memory_order_release);
+
+    victim->tag.store(index + 1, std::memory_order_relaxed);
+    for (size_t i = 0; i < num_words; ++i)
+        victim->words[i].store(item.word64s[i], std::memory_order_relaxed);
+
+    victim->version.store(v + 2, std::memory_order_release);
+}
+
+item_cache* create_item_cache(size_t size) noexcept
+{
+    const size_t num_sets = size / sizeof(item_cache::set);
+    if (num_sets == 0)
+        return nullptr;
+
+    // The zero-filled memory represents empty slots. Allocate it with calloc() so that
+    // the pages of big caches are only committed when used.
+    auto* const sets = static_cast<item_cache::set*>(std::calloc(num_sets, sizeof(item_cache::set)));
+    if (sets == nullptr)
+        return nullptr;
+
+    auto* const cache = new (std::nothrow) item_cache{num_sets, sets, {0}, {0}};
+    if (cache == nullptr)
+        std::free(sets);
+    return cache;
+}
+
+void destroy_item_cache(item_cache* cache) noexcept
+{
+    if (cache == nullptr)
+        return;
+    std::free(cache->sets);
+    delete cache;
+}
+}  // namespace ethash
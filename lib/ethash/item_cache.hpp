@@ -0,0 +1,70 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The bounded-memory cache of full dataset items computed by light hashing.
+
+#pragma once
+
+#include <ethash/hash_types.hpp>
+#include <atomic>
+#include <cstddef>
+
+namespace ethash
+{
+/// The set-associative cache of full dataset items.
+///
+/// Each slot is protected by a sequence lock: readers never block and never write to shared
+/// memory, a slot being concurrently updated is reported as a miss.
+/// Writers skip the insertion when a slot is already locked by another writer.
+struct item_cache
+{
+    static constexpr int num_ways = 4;
+    static constexpr size_t num_words = sizeof(hash1024) / sizeof(uint64_t);
+
+    struct slot
+    {
+        /// The sequence number. Odd values mean the slot is being written.
+        std::atomic<uint32_t> version;
+
+        /// The item index + 1, or 0 for empty slot.
+        std::atomic<uint32_t> tag;
+
+        std::atomic<uint64_t> words[num_words];
+    };
+
+    struct set
+    {
+        slot slots[num_ways];
+        std::atomic<uint32_t> next_victim;
+    };
+
+    size_t num_sets;
+    set* sets;
+
+    std::atomic<uint64_t> num_hits;
+    std::atomic<uint64_t> num_misses;
+
+    /// Loads the item of the given index. Returns false if not in the cache.
+    bool load(uint32_t index, hash1024& item) const noexcept;
+
+    /// Stores the item of the given index (best effort).
+    void store(uint32_t index, const hash1024& item) noexcept;
+
+    void record(uint64_t hits, uint64_t misses) noexcept
+    {
+        num_hits.fetch_add(hits, std::memory_order_relaxed);
+        num_misses.fetch_add(misses, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const noexcept { return num_sets * num_ways; }
+};
+
+/// Creates the item cache using up to the given amount of memory.
+///
+/// @return  The cache or null in case the size is too small or memory allocation failed.
+item_cache* create_item_cache(size_t size) noexcept;
+
+void destroy_item_cache(item_cache* cache) noexcept;
+}  // namespace ethash
@@ -3,14 +3,64 @@
 // Licensed under the Apache License, Version 2.0.
 #include "primes.h"
 #include <stdbool.h>
+#include <stddef.h>
+
+/// Computes (base ^ exponent) mod modulus.
+static inline uint32_t pow_mod(uint32_t base, uint32_t exponent, uint32_t modulus)
+{
+    uint64_t result = 1;
+    uint64_t b = base % modulus;
+    while (exponent != 0)
+    {
+        if (exponent & 1)
+            result = (result * b) % modulus;
+        b = (b * b) % modulus;
+        exponent >>= 1;
+    }
+    return (uint32_t)result;
+}
+
+/// Checks if the odd number n = d * 2^s + 1 is a strong probable prime to the given base.
+static inline bool is_strong_probable_prime(uint32_t n, uint32_t d, int s, uint32_t base)
+{
+    uint64_t x = pow_mod(base, d, n);
+    if (x == 1 || x == n - 1)
+        return true;
+
+    for (int r = 1; r < s; ++r)
+    {
+        x = (x * x) % n;
+        if (x == n - 1)
+            return true;
+    }
+    return false;
+}
 
 /// Checks if the number is prime. Requires the number to be > 2 and odd.
+///
+/// This is the Miller-Rabin test with the bases 2, 7 and 61, which is deterministic
+/// for all numbers below 4759123141, so for all positive 32-bit signed integers.
 static inline bool is_odd_prime(int number)
 {
-    // Check factors up to sqrt(number) by doing comparison d*d <= number with 64-bit precision.
-    for (int d = 3; (int64_t)d * (int64_t)d <= (int64_t)number; d += 2)
+    static const uint32_t bases[] = {2, 7, 61};
+
+    const uint32_t n = (uint32_t)number;
+
+    uint32_t d = n - 1;
+    int s = 0;
+    while (d % 2 == 0)
     {
-        if (number % d == 0)
+        d /= 2;
+        ++s;
+    }
+
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); ++i)
+    {
+        // Skip the base being a multiple of the number, i.e. the number is the base itself.
+        if (bases[i] % n == 0)
+            continue;
+
+        if (!is_strong_probable_prime(n, d, s, bases[i]))
             return false;
     }
 
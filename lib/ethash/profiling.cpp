@@ -0,0 +1,54 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "profiling.hpp"
+
+#ifdef ETHASH_ENABLE_PROFILING
+namespace ethash
+{
+namespace profiling
+{
+thread_local ethash_profiling_snapshot counters{};
+}  // namespace profiling
+}  // namespace ethash
+#endif
+
+extern "C" {
+
+bool ethash_profiling_enabled(void) noexcept
+{
+#ifdef ETHASH_ENABLE_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+ethash_profiling_snapshot ethash_profiling_get_snapshot(void) noexcept
+{
+#ifdef ETHASH_ENABLE_PROFILING
+    ethash_profiling_snapshot snapshot = ethash::profiling::counters;
+
+    const auto& mix = snapshot.phases[ETHASH_PROFILING_MIX];
+    uint64_t lookup_cycles = 0;
+    for (int phase = ETHASH_PROFILING_LOOKUP_READY; phase <= ETHASH_PROFILING_LOOKUP_COMPUTED;
+         ++phase)
+        lookup_cycles += snapshot.phases[phase].cycles;
+
+    auto& fnv_mix = snapshot.phases[ETHASH_PROFILING_FNV_MIX];
+    fnv_mix.cycles = mix.cycles > lookup_cycles ? mix.cycles - lookup_cycles : 0;
+    fnv_mix.events = mix.events;
+    return snapshot;
+#else
+    return {};
+#endif
+}
+
+void ethash_profiling_reset(void) noexcept
+{
+#ifdef ETHASH_ENABLE_PROFILING
+    ethash::profiling::counters = {};
+#endif
+}
+}
@@ -0,0 +1,92 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The instrumentation of the profiling mode. See ethash/profiling.h.
+///
+/// Without ETHASH_ENABLE_PROFILING defined the instrumentation macros expand to nothing.
+
+#pragma once
+
+#include <ethash/profiling.h>
+
+#ifdef ETHASH_ENABLE_PROFILING
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace ethash
+{
+namespace profiling
+{
+extern thread_local ethash_profiling_snapshot counters;
+
+inline uint64_t read_cycles() noexcept
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t t;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+/// Records the cycles spent in the scope to the given phase.
+class scope
+{
+    int m_phase;
+    const uint64_t m_num_events;
+    const uint64_t m_start = read_cycles();
+
+public:
+    explicit scope(int phase, uint64_t num_events = 1) noexcept
+      : m_phase{phase}, m_num_events{num_events}
+    {}
+
+    ~scope() noexcept
+    {
+        auto& c = counters.phases[m_phase];
+        c.cycles += read_cycles() - m_start;
+        c.events += m_num_events;
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+    /// Changes the phase the scope is recorded to, when it is known only after the start.
+    void set_phase(int phase) noexcept { m_phase = phase; }
+};
+}  // namespace profiling
+}  // namespace ethash
+
+#define ETHASH_PROFILING_CONCAT_(a, b) a##b
+#define ETHASH_PROFILING_CONCAT(a, b) ETHASH_PROFILING_CONCAT_(a, b)
+
+/// Profiles the rest of the enclosing scope as the given phase.
+#define ETHASH_PROFILE_SCOPE(...) \
+    const ethash::profiling::scope ETHASH_PROFILING_CONCAT(profiling_scope_, __LINE__)(__VA_ARGS__)
+
+/// Profiles the rest of the enclosing scope as the given phase. The phase can be changed
+/// later with ETHASH_PROFILE_SET_PHASE(name, phase).
+#define ETHASH_PROFILE_NAMED_SCOPE(name, ...) ethash::profiling::scope name(__VA_ARGS__)
+
+#define ETHASH_PROFILE_SET_PHASE(name, phase) name.set_phase(phase)
+
+#else
+
+#define ETHASH_PROFILE_SCOPE(...) static_cast<void>(0)
+#define ETHASH_PROFILE_NAMED_SCOPE(name, ...) static_cast<void>(0)
+#define ETHASH_PROFILE_SET_PHASE(name, phase) static_cast<void>(0)
+
+#endif
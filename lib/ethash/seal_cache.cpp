@@ -0,0 +1,120 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "seal_cache.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace ethash
+{
+namespace
+{
+/// Packs the seal into the words of a slot.
+inline void make_key(uint64_t (&key)[seal_cache::num_words], const hash256& header_hash,
+    uint64_t nonce, const hash256& mix_hash) noexcept
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        key[i] = header_hash.word64s[i];
+        key[4 + i] = mix_hash.word64s[i];
+    }
+    key[8] = nonce;
+}
+
+/// Selects the set of the seal. The header hash is a Keccak hash so its bits are uniform.
+inline size_t set_index(
+    const seal_cache& cache, const uint64_t (&key)[seal_cache::num_words]) noexcept
+{
+    return static_cast<size_t>(key[0] ^ key[8]) % cache.num_sets;
+}
+}  // namespace
+
+bool seal_cache::contains(
+    const hash256& header_hash, uint64_t nonce, const hash256& mix_hash) noexcept
+{
+    uint64_t key[num_words];
+    make_key(key, header_hash, nonce, mix_hash);
+    const set& s = sets[set_index(*this, key)];
+
+    for (const auto& e : s.slots)
+    {
+        const uint32_t v1 = e.version.load(std::memory_order_acquire);
+        if (v1 == 0 || v1 % 2 != 0)
+            continue;
+
+        bool match = true;
+        for (size_t i = 0; i < num_words; ++i)
+            match &= e.words[i].load(std::memory_order_relaxed) == key[i];
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (match && e.version.load(std::memory_order_relaxed) == v1)
+        {
+            num_hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    num_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void seal_cache::store(
+    const hash256& header_hash, uint64_t nonce, const hash256& mix_hash) noexcept
+{
+    uint64_t key[num_words];
+    make_key(key, header_hash, nonce, mix_hash);
+    set& s = sets[set_index(*this, key)];
+
+    // Pick the never written slot if available, otherwise evict in round-robin order.
+    slot* victim = nullptr;
+    for (auto& e : s.slots)
+    {
+        if (e.version.load(std::memory_order_relaxed) == 0)
+        {
+            victim = &e;
+            break;
+        }
+    }
+    if (victim == nullptr)
+        victim = &s.slots[s.next_victim.fetch_add(1, std::memory_order_relaxed) % num_ways];
+
+    uint32_t v = victim->version.load(std::memory_order_relaxed);
+    if (v % 2 != 0 ||
+        !victim->version.compare_exchange_strong(v, v + 1, std::memory_order_acquire))
+        return;  // Other writer owns the slot, skip.
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < num_words; ++i)
+        victim->words[i].store(key[i], std::memory_order_relaxed);
+
+    // Skip 0 on the wrap around, it marks never written slots.
+    const uint32_t next_version = v + 2 != 0 ? v + 2 : 2;
+    victim->version.store(next_version, std::memory_order_release);
+}
+
+seal_cache* create_seal_cache(size_t size) noexcept
+{
+    const size_t num_sets = size / sizeof(seal_cache::set);
+    if (num_sets == 0)
+        return nullptr;
+
+    // The zero-filled memory represents never written slots.
+    auto* const sets =
+        static_cast<seal_cache::set*>(std::calloc(num_sets, sizeof(seal_cache::set)));
+    if (sets == nullptr)
+        return nullptr;
+
+    auto* const cache = new (std::nothrow) seal_cache{num_sets, sets, {0}, {0}};
+    if (cache == nullptr)
+        std::free(sets);
+    return cache;
+}
+
+void destroy_seal_cache(seal_cache* cache) noexcept
+{
+    if (cache == nullptr)
+        return;
+    std::free(cache->sets);
+    delete cache;
+}
+}  // namespace ethash
@@ -0,0 +1,64 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The fixed-size cache of successfully verified seals.
+
+#pragma once
+
+#include <ethash/hash_types.hpp>
+#include <atomic>
+#include <cstddef>
+
+namespace ethash
+{
+/// The set-associative cache of the seals (header hash, nonce, mix hash) which have passed
+/// the mix hash verification in the epoch of the context owning the cache.
+///
+/// Each slot is protected by a sequence lock like in the item_cache: readers never block,
+/// a slot being concurrently updated is reported as a miss. Writers skip the insertion
+/// when a slot is already locked by another writer.
+struct seal_cache
+{
+    static constexpr int num_ways = 4;
+    static constexpr size_t num_words = (2 * sizeof(hash256) + sizeof(uint64_t)) / sizeof(uint64_t);
+
+    struct slot
+    {
+        /// The sequence number. Odd values mean the slot is being written,
+        /// 0 means the slot has never been written.
+        std::atomic<uint32_t> version;
+
+        /// The header hash, the mix hash and the nonce.
+        std::atomic<uint64_t> words[num_words];
+    };
+
+    struct set
+    {
+        slot slots[num_ways];
+        std::atomic<uint32_t> next_victim;
+    };
+
+    size_t num_sets;
+    set* sets;
+
+    std::atomic<uint64_t> num_hits;
+    std::atomic<uint64_t> num_misses;
+
+    /// Checks if the seal is in the cache and counts the hit or the miss.
+    bool contains(const hash256& header_hash, uint64_t nonce, const hash256& mix_hash) noexcept;
+
+    /// Stores the verified seal (best effort).
+    void store(const hash256& header_hash, uint64_t nonce, const hash256& mix_hash) noexcept;
+
+    size_t capacity() const noexcept { return num_sets * num_ways; }
+};
+
+/// Creates the seal cache using up to the given amount of memory.
+///
+/// @return  The cache or null in case the size is too small or memory allocation failed.
+seal_cache* create_seal_cache(size_t size) noexcept;
+
+void destroy_seal_cache(seal_cache* cache) noexcept;
+}  // namespace ethash
@@ -0,0 +1,37 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The USDT (user-level statically defined tracing) probes of the "ethash" provider.
+///
+/// With ETHASH_ENABLE_USDT defined the probes are emitted with <sys/sdt.h>: each one is a single
+/// nop instruction plus an ELF note, so they cost nothing until a tracer (e.g. bpftrace,
+/// perf or SystemTap) attaches to them. Otherwise the macros expand to nothing.
+///
+/// The probes:
+/// - context_create_start(int epoch_number, bool full),
+/// - context_create_end(int epoch_number, bool full, const epoch_context* context),
+/// - light_cache_build_start(int num_items),
+/// - light_cache_build_end(int num_items),
+/// - update_local_context_start(int epoch_number, bool full),
+/// - update_local_context_end(int epoch_number, bool full, const epoch_context* context),
+/// - dataset_item_lazy(int epoch_number, uint32_t index).
+
+#pragma once
+
+#ifdef ETHASH_ENABLE_USDT
+
+#include <sys/sdt.h>
+
+#define ETHASH_TRACE1(name, a) DTRACE_PROBE1(ethash, name, a)
+#define ETHASH_TRACE2(name, a, b) DTRACE_PROBE2(ethash, name, a, b)
+#define ETHASH_TRACE3(name, a, b, c) DTRACE_PROBE3(ethash, name, a, b, c)
+
+#else
+
+#define ETHASH_TRACE1(name, a) static_cast<void>(0)
+#define ETHASH_TRACE2(name, a, b) static_cast<void>(0)
+#define ETHASH_TRACE3(name, a, b, c) static_cast<void>(0)
+
+#endif
@@ -3,10 +3,28 @@
 // Licensed under the Apache License, Version 2.0.
 
 #include "../ethash/ethash-internal.hpp"
+#include "../ethash/tracing.hpp"
+#include "verify_pool.hpp"
+#include "verify_seal.hpp"
 #include <ethash/global_context.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #if !defined(__has_cpp_attribute)
 #define __has_cpp_attribute(x) 0
@@ -24,67 +42,1082 @@ using namespace ethash;
 
 namespace
 {
+/// The memory size of all the contexts allocated by the global context manager.
+std::atomic<size_t> allocated_memory_size{0};
+
+/// The statistics counters of the global context manager. See ethash_global_context_stats.
+std::atomic<uint64_t> num_shared_hits{0};
+std::atomic<uint64_t> num_misses{0};
+std::atomic<uint64_t> num_light_builds{0};
+std::atomic<uint64_t> light_build_time_ns{0};
+std::atomic<uint64_t> last_light_build_time_ns{0};
+std::atomic<uint64_t> num_full_builds{0};
+std::atomic<uint64_t> full_build_time_ns{0};
+std::atomic<uint64_t> last_full_build_time_ns{0};
+std::atomic<uint64_t> num_lock_waits{0};
+std::atomic<uint64_t> lock_wait_time_ns{0};
+
+/// The thread-local hits of the exited threads.
+std::atomic<uint64_t> num_retired_thread_local_hits{0};
+
+/// The number of thread-local hits of the current thread.
+///
+/// Only written by the owning thread, without read-modify-write atomic operations. It is
+/// constant-initialized, so counting does not slow down the fast path.
+thread_local std::atomic<uint64_t> num_thread_local_hits{0};
+
+inline void record_thread_local_hit() noexcept
+{
+    num_thread_local_hits.store(
+        num_thread_local_hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/// The registration of the thread-local counters in the global list to be summed up.
+struct thread_stats
+{
+    const std::atomic<uint64_t>* thread_local_hits = &num_thread_local_hits;
+    thread_stats* prev = nullptr;
+    thread_stats* next = nullptr;
+
+    thread_stats() noexcept;
+    ~thread_stats() noexcept;
+
+    thread_stats(const thread_stats&) = delete;
+    thread_stats& operator=(const thread_stats&) = delete;
+};
+
+std::mutex thread_stats_mutex;
+
+/// The head of the list of the thread_stats of live threads. Guarded by thread_stats_mutex.
+thread_stats* thread_stats_list = nullptr;
+
+thread_stats::thread_stats() noexcept
+{
+    std::lock_guard<std::mutex> lock{thread_stats_mutex};
+    next = thread_stats_list;
+    if (next != nullptr)
+        next->prev = this;
+    thread_stats_list = this;
+}
+
+thread_stats::~thread_stats() noexcept
+{
+    std::lock_guard<std::mutex> lock{thread_stats_mutex};
+    if (prev != nullptr)
+        prev->next = next;
+    else
+        thread_stats_list = next;
+    if (next != nullptr)
+        next->prev = prev;
+    num_retired_thread_local_hits.fetch_add(
+        thread_local_hits->load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/// Registers the counters of the current thread. Called on the slow paths, which always
+/// precede the thread-local hits.
+inline void register_thread_stats() noexcept
+{
+    thread_local thread_stats stats;
+    (void)stats;
+}
+
+using steady_clock = std::chrono::steady_clock;
+
+inline uint64_t elapsed_ns(steady_clock::time_point start_time) noexcept
+{
+    const auto elapsed = steady_clock::now() - start_time;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+/// The reference-counted record of a shared epoch context.
+///
+/// The records are never deallocated, only recycled. Therefore a reader can safely try to
+/// acquire a reference to a record it has found in the table of published records, even if
+/// the record is concurrently released and reused for another context. After acquiring,
+/// the reader validates the key of the record. This makes the read path lock-free.
+struct context_record
+{
+    /// The number of references: one from the table of published records
+    /// and one per each thread-local handle.
+    std::atomic<int> num_refs{0};
+
+    /// The key identifying the context: epoch_number * 2 + full, -1 if the record is free.
+    std::atomic<int> key{-1};
+
+    /// The logical time of the last lookup of the record, for the LRU eviction.
+    std::atomic<uint64_t> last_used{0};
+
+    /// The record is in use until the context is destroyed after the last reference is dropped.
+    /// Guarded by shared_context_mutex for the writers.
+    std::atomic<bool> in_use{false};
+
+    /// The owned context, immutable while the record is in use.
+    /// Only written by the writers holding shared_context_mutex.
+    epoch_context_full* context = nullptr;
+
+    /// The memory size of the context. Written together with the context.
+    size_t memory_size = 0;
+
+    /// The record of the light context whose light cache the full context uses, referenced
+    /// until the context is destroyed. Written together with the context.
+    context_record* light_record = nullptr;
+
+    static int make_key(int epoch_number, bool full) noexcept { return epoch_number * 2 + full; }
+
+    /// Tries to acquire a reference. Fails if the record has no references left.
+    bool try_acquire() noexcept
+    {
+        int n = num_refs.load(std::memory_order_relaxed);
+        do
+        {
+            if (n == 0)
+                return false;
+        } while (!num_refs.compare_exchange_weak(n, n + 1, std::memory_order_acquire));
+        return true;
+    }
+
+    void release() noexcept
+    {
+        if (num_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // The dangling context pointer stays until the record is reused.
+            key.store(-1, std::memory_order_relaxed);
+            allocated_memory_size.fetch_sub(memory_size, std::memory_order_relaxed);
+            ethash_destroy_epoch_context_full(context);
+            if (light_record != nullptr)
+            {
+                light_record->release();
+                light_record = nullptr;
+            }
+            in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+/// The owned reference to a context record.
+template <typename Context>
+class context_handle
+{
+    context_record* m_record = nullptr;
+    const Context* m_context = nullptr;
+
+public:
+    context_handle() noexcept = default;
+    ~context_handle() noexcept { reset(); }
+
+    context_handle(context_handle&& other) noexcept
+      : m_record{other.m_record}, m_context{other.m_context}
+    {
+        other.m_record = nullptr;
+        other.m_context = nullptr;
+    }
+
+    context_handle(const context_handle&) = delete;
+    context_handle& operator=(const context_handle&) = delete;
+
+    /// Takes the ownership of the already acquired reference.
+    void reset(context_record* record = nullptr) noexcept
+    {
+        if (m_record != nullptr)
+            m_record->release();
+        m_record = record;
+        m_context = record != nullptr ? record->context : nullptr;
+    }
+
+    const Context* get() const noexcept { return m_context; }
+    const Context& operator*() const noexcept { return *m_context; }
+    const Context* operator->() const noexcept { return m_context; }
+    explicit operator bool() const noexcept { return m_context != nullptr; }
+};
+
+/// The maximum number of published shared contexts.
+constexpr int max_num_published_contexts = 32;
+
+/// The table of published records. Readers scan it without locking.
+std::atomic<context_record*> published_contexts[max_num_published_contexts];
+
+/// The logical clock for the LRU eviction.
+std::atomic<uint64_t> lookup_clock{0};
+
+/// The mutex serializing the writers: building, publishing and evicting contexts.
 std::mutex shared_context_mutex;
-std::shared_ptr<epoch_context> shared_context;
-thread_local std::shared_ptr<epoch_context> thread_local_context;
 
-std::mutex shared_context_full_mutex;
-std::shared_ptr<epoch_context_full> shared_context_full;
-thread_local std::shared_ptr<epoch_context_full> thread_local_context_full;
+/// Locks the shared_context_mutex recording the time spent waiting for it.
+inline void lock_shared_contexts(std::unique_lock<std::mutex>& lock) noexcept
+{
+    if (lock.try_lock())
+        return;
 
-/// Update thread local epoch context.
+    const auto start_time = steady_clock::now();
+    lock.lock();
+    num_lock_waits.fetch_add(1, std::memory_order_relaxed);
+    lock_wait_time_ns.fetch_add(elapsed_ns(start_time), std::memory_order_relaxed);
+}
+
+/// Returns the lock of the shared_context_mutex, see lock_shared_contexts().
+inline std::unique_lock<std::mutex> lock_shared_contexts() noexcept
+{
+    std::unique_lock<std::mutex> lock{shared_context_mutex, std::defer_lock};
+    lock_shared_contexts(lock);
+    return lock;
+}
+
+/// The pool of all records ever created. Guarded by shared_context_mutex.
+std::list<context_record> context_records;
+
+/// The maximum number of shared light contexts. Guarded by shared_context_mutex.
+int shared_contexts_max_size = 3;
+
+/// The memory budget for the shared light contexts. Zero means unlimited.
+/// Guarded by shared_context_mutex.
+size_t shared_contexts_memory_budget = 0;
+
+/// The maximum number of shared full contexts: the one in use and the prepared one.
+constexpr int max_num_full_contexts = 2;
+
+/// The memory limit for the shared full contexts. Zero means unlimited.
+/// Guarded by shared_context_mutex.
+size_t full_contexts_memory_limit = 0;
+
+/// The memory budget for all the contexts allocated by the global context manager.
+/// Zero means unlimited. Guarded by shared_context_mutex.
+size_t total_memory_budget = 0;
+
+/// The memory size of the contexts being built. Guarded by shared_context_mutex.
+size_t reserved_memory_size = 0;
+
+/// The nice value of the threads doing background work.
+constexpr int background_nice_value = 10;
+
+thread_local context_handle<epoch_context> thread_local_context;
+thread_local context_handle<epoch_context_full> thread_local_context_full;
+
+/// Runs fn(i) for all i in [0, n) using up to num_threads threads, including the calling one.
+template <typename Fn>
+void parallel_for(size_t n, int num_threads, const Fn& fn) noexcept
+{
+    std::atomic<size_t> next{0};
+    const auto work = [&]() noexcept {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+             i = next.fetch_add(1, std::memory_order_relaxed))
+            fn(i);
+    };
+
+    std::vector<std::thread> threads;
+    const size_t num_helpers = std::min(n, static_cast<size_t>(num_threads)) - (n != 0);
+    try
+    {
+        threads.reserve(num_helpers);
+        for (size_t t = 0; t < num_helpers; ++t)
+            threads.emplace_back(work);
+    }
+    catch (...)
+    {
+        // Continue with the threads created so far.
+    }
+
+    work();
+    for (auto& t : threads)
+        t.join();
+}
+
+/// Finds the published record of the given key and acquires the reference to it. Lock-free.
+context_record* find_published(int key) noexcept
+{
+    for (auto& slot : published_contexts)
+    {
+        context_record* const record = slot.load(std::memory_order_acquire);
+        if (record == nullptr || record->key.load(std::memory_order_relaxed) != key)
+            continue;
+
+        if (!record->try_acquire())
+            continue;
+
+        // The record might have been recycled before the reference was acquired.
+        if (record->key.load(std::memory_order_relaxed) == key)
+        {
+            record->last_used.store(
+                lookup_clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+            return record;
+        }
+
+        record->release();
+    }
+    return nullptr;
+}
+
+/// Returns the size of memory occupied by the light context of the given epoch.
+inline size_t get_context_memory_size(int epoch_number) noexcept
+{
+    return get_light_cache_size(calculate_light_cache_num_items(epoch_number));
+}
+
+/// Removes the record from the table of published records. The shared_context_mutex
+/// must be locked.
+void unpublish(std::atomic<context_record*>& slot) noexcept
+{
+    context_record* const record = slot.exchange(nullptr, std::memory_order_relaxed);
+    record->release();
+}
+
+/// Evicts the published light contexts in the least recently used order until the given
+/// number of contexts and the given amount of memory is available.
+/// The shared_context_mutex must be locked.
+void evict_shared_contexts(size_t num_contexts, size_t memory_size) noexcept
+{
+    while (true)
+    {
+        size_t num_light = num_contexts;
+        size_t total_memory_size = memory_size;
+        std::atomic<context_record*>* lru_slot = nullptr;
+        uint64_t lru_time = ~uint64_t{0};
+        for (auto& slot : published_contexts)
+        {
+            const auto* record = slot.load(std::memory_order_relaxed);
+            if (record == nullptr || record->key.load(std::memory_order_relaxed) % 2 != 0)
+                continue;
+
+            ++num_light;
+            total_memory_size += get_context_memory_size(record->context->epoch_number);
+            const auto t = record->last_used.load(std::memory_order_relaxed);
+            if (t < lru_time)
+            {
+                lru_time = t;
+                lru_slot = &slot;
+            }
+        }
+
+        const bool over_budget =
+            num_light > static_cast<size_t>(shared_contexts_max_size) ||
+            (shared_contexts_memory_budget != 0 && total_memory_size > shared_contexts_memory_budget);
+        if (lru_slot == nullptr || !over_budget)
+            return;
+
+        unpublish(*lru_slot);
+    }
+}
+
+/// Returns the size of memory occupied by the full context of the given epoch.
+inline size_t get_context_full_memory_size(int epoch_number) noexcept
+{
+    return get_context_memory_size(epoch_number) +
+           get_full_dataset_size(calculate_full_dataset_num_items(epoch_number));
+}
+
+/// Evicts the published full contexts of the epochs matching the predicate.
+/// The shared_context_mutex must be locked.
+template <typename Predicate>
+void evict_full_contexts(const Predicate& predicate) noexcept
+{
+    for (auto& slot : published_contexts)
+    {
+        const auto* record = slot.load(std::memory_order_relaxed);
+        if (record == nullptr)
+            continue;
+        const int key = record->key.load(std::memory_order_relaxed);
+        if (key % 2 != 0 && predicate(key / 2))
+            unpublish(slot);
+    }
+}
+
+/// Checks if the full context of the given epoch can be published along the full contexts
+/// already published without exceeding the full memory limit.
+/// The shared_context_mutex must be locked.
+bool fits_full_memory_limit(int epoch_number) noexcept
+{
+    if (full_contexts_memory_limit == 0)
+        return true;
+
+    size_t total_memory_size = get_context_full_memory_size(epoch_number);
+    for (auto& slot : published_contexts)
+    {
+        const auto* record = slot.load(std::memory_order_relaxed);
+        if (record == nullptr)
+            continue;
+        if (record->key.load(std::memory_order_relaxed) % 2 != 0)
+            total_memory_size += record->memory_size;
+    }
+    return total_memory_size <= full_contexts_memory_limit;
+}
+
+/// Returns the memory size of the context of the given key.
+inline size_t get_memory_size(int key) noexcept
+{
+    return (key % 2 != 0) ? get_context_full_memory_size(key / 2) :
+                            get_context_memory_size(key / 2);
+}
+
+/// Checks if the published record is only referenced by the table of published records,
+/// so evicting it frees its memory.
+inline bool is_unreferenced(const context_record& record) noexcept
+{
+    return record.num_refs.load(std::memory_order_relaxed) == 1;
+}
+
+/// Checks if the context of the given memory size fits in the total memory budget,
+/// possibly after evicting the unreferenced contexts. The shared_context_mutex must be locked.
+bool fits_memory_budget(size_t memory_size) noexcept
+{
+    if (total_memory_budget == 0)
+        return true;
+
+    size_t evictable_memory_size = 0;
+    for (auto& slot : published_contexts)
+    {
+        const auto* record = slot.load(std::memory_order_relaxed);
+        if (record != nullptr && is_unreferenced(*record))
+            evictable_memory_size += record->memory_size;
+    }
+
+    return allocated_memory_size.load(std::memory_order_relaxed) + reserved_memory_size +
+               memory_size <=
+           total_memory_budget + evictable_memory_size;
+}
+
+/// Reserves the memory for the context to be built. If needed, evicts the least recently used
+/// unreferenced contexts to stay within the total memory budget.
+/// The shared_context_mutex must be locked.
+void reserve_memory(size_t memory_size) noexcept
+{
+    reserved_memory_size += memory_size;
+    if (total_memory_budget == 0)
+        return;
+
+    while (allocated_memory_size.load(std::memory_order_relaxed) + reserved_memory_size >
+           total_memory_budget)
+    {
+        std::atomic<context_record*>* lru_slot = nullptr;
+        uint64_t lru_time = ~uint64_t{0};
+        for (auto& slot : published_contexts)
+        {
+            const auto* record = slot.load(std::memory_order_relaxed);
+            if (record == nullptr || !is_unreferenced(*record))
+                continue;
+            const auto t = record->last_used.load(std::memory_order_relaxed);
+            if (t < lru_time)
+            {
+                lru_time = t;
+                lru_slot = &slot;
+            }
+        }
+        if (lru_slot == nullptr)
+            return;
+        unpublish(*lru_slot);
+    }
+}
+
+/// Lowers the scheduling priority of the calling thread doing background work.
+void lower_thread_priority() noexcept
+{
+#if defined(__linux__)
+    // On Linux the nice value is a per-thread attribute.
+    thread_local bool lowered = false;
+    if (!lowered)
+    {
+        lowered = true;
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), background_nice_value);
+    }
+#endif
+}
+
+/// Publishes the newly built context. The reference to the light_record the context shares
+/// the light cache with is taken over. Returns the acquired record or null in case of memory
+/// allocation failure. The shared_context_mutex must be locked.
+context_record* publish(
+    int key, epoch_context_full* context, context_record* light_record = nullptr) noexcept
+{
+    // Find a free record or create a new one.
+    auto it = std::find_if(context_records.begin(), context_records.end(),
+        [](const context_record& r) noexcept { return !r.in_use.load(std::memory_order_acquire); });
+    if (it == context_records.end())
+    {
+        try
+        {
+            it = context_records.emplace(context_records.end());
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+    context_record& record = *it;
+
+    // Release the least recently used light contexts to make room for the new one.
+    // The full contexts are evicted by the caller.
+    if (key % 2 == 0)
+        evict_shared_contexts(1, get_context_memory_size(key / 2));
+
+    // There is always a free slot after the eviction.
+    const auto free_slot = std::find_if(std::begin(published_contexts),
+        std::end(published_contexts), [](const std::atomic<context_record*>& slot) noexcept {
+            return slot.load(std::memory_order_relaxed) == nullptr;
+        });
+
+    record.context = context;
+    record.memory_size = get_memory_size(key);
+    if (light_record != nullptr)
+        record.memory_size -= get_context_memory_size(key / 2);
+    record.light_record = light_record;
+    allocated_memory_size.fetch_add(record.memory_size, std::memory_order_relaxed);
+    record.in_use.store(true, std::memory_order_relaxed);
+    record.key.store(key, std::memory_order_relaxed);
+    record.last_used.store(
+        lookup_clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    record.num_refs.store(2, std::memory_order_release);  // The table and the caller.
+    free_slot->store(&record, std::memory_order_release);
+    return &record;
+}
+
+/// The keys of the contexts being built. Guarded by shared_context_mutex.
+std::set<int> pending_builds;
+
+/// Notified when a build has finished and its key has been removed from pending_builds.
+std::condition_variable build_finished_cv;
+
+/// Finds or builds the shared context of the given key and returns the acquired record
+/// or null in case of memory allocation failure.
+///
+/// The context is built without holding the shared_context_mutex so lookups and builds of
+/// other contexts are not blocked. The concurrent requests for the same context wait for
+/// the single build. If it fails, they try to build the context themselves.
+///
+/// A full context built on demand replaces the published full context. If num_threads > 0,
+/// the full dataset is generated with the given number of low-priority threads before the
+/// context is published along the full context in use (double buffering). This generation
+/// is abandoned and the build fails when the optional cancelled flag is set.
 ///
 /// This function is on the slow path. It's separated to allow inlining the fast
 /// path.
-///
-/// @todo: Redesign to guarantee deallocation before new allocation.
 ATTRIBUTE_NOINLINE
-void update_local_context(int epoch_number)
+context_record* get_shared_context(
+    int key, int num_threads = 0, const std::atomic<bool>* cancelled = nullptr) noexcept
 {
-    // Release the shared pointer of the obsoleted context.
-    thread_local_context.reset();
+    const int epoch_number = key / 2;
+    const bool full = key % 2 != 0;
+    const bool prepare = full && num_threads > 0;
+
+    // The request is counted once: as the shared hit if the context has already been published,
+    // otherwise as the miss, also when it waits for the build of other thread.
+    bool counted = false;
+    const auto count = [&counted](std::atomic<uint64_t>& counter) noexcept {
+        if (!counted)
+            counter.fetch_add(1, std::memory_order_relaxed);
+        counted = true;
+    };
+
+    while (true)
+    {
+        // Lock-free lookup of the context already built.
+        if (auto* record = find_published(key))
+        {
+            count(num_shared_hits);
+            return record;
+        }
+
+        auto lock = lock_shared_contexts();
+
+        // Check again, the context might have been published in the meantime.
+        if (auto* record = find_published(key))
+        {
+            count(num_shared_hits);
+            return record;
+        }
+
+        count(num_misses);
+
+        if (pending_builds.count(key) != 0)
+        {
+            // Other thread builds the context, wait for it and look it up again.
+            build_finished_cv.wait(lock, [key] { return pending_builds.count(key) == 0; });
+            lock.unlock();
+            continue;
+        }
+
+        // The full context shares the light cache of the light context if available.
+        context_record* light_record =
+            full ? find_published(context_record::make_key(epoch_number, false)) : nullptr;
+        size_t memory_size = get_memory_size(key);
+        if (light_record != nullptr)
+            memory_size -= get_context_memory_size(epoch_number);
+
+        // Full contexts exceeding the memory budget are refused. Light contexts are small
+        // and required for verification, so they are always built.
+        if (full && !fits_memory_budget(memory_size))
+        {
+            if (light_record != nullptr)
+                light_record->release();
+            return nullptr;
+        }
 
-    // Local context invalid, check the shared context.
-    std::lock_guard<std::mutex> lock{shared_context_mutex};
+        // Register the build for the concurrent requests to wait for it.
+        try
+        {
+            pending_builds.insert(key);
+        }
+        catch (...)
+        {
+            if (light_record != nullptr)
+                light_record->release();
+            return nullptr;
+        }
 
-    if (!shared_context || shared_context->epoch_number != epoch_number)
+        // The build goes ahead, make room for the new context. Release the full contexts
+        // in use before building the new one if both do not fit in the memory limit.
+        if (full && !fits_full_memory_limit(epoch_number))
+            evict_full_contexts([](int) noexcept { return true; });
+        reserve_memory(memory_size);
+
+        lock.unlock();
+
+        const auto start_time = steady_clock::now();
+        epoch_context_full* context = nullptr;
+        if (light_record != nullptr)
+            context = create_epoch_context_full_sharing_light_cache(*light_record->context);
+        else
+        {
+            context = full ?
+                          ethash_create_epoch_context_full(epoch_number) :
+                          static_cast<epoch_context_full*>(ethash_create_epoch_context(epoch_number));
+        }
+
+        if (context != nullptr && prepare)
+        {
+            static constexpr int chunk_size = 4096;
+            const int num_items = context->full_dataset_num_items;
+            const int num_chunks = (num_items + chunk_size - 1) / chunk_size;
+            const auto is_cancelled = [cancelled]() noexcept {
+                return cancelled != nullptr && cancelled->load(std::memory_order_relaxed);
+            };
+            lower_thread_priority();
+            parallel_for(static_cast<size_t>(num_chunks), num_threads, [&](size_t i) noexcept {
+                if (is_cancelled())
+                    return;
+                lower_thread_priority();
+                ethash_generate_full_dataset_items(
+                    context, static_cast<int>(i) * chunk_size, chunk_size);
+            });
+
+            if (is_cancelled())
+            {
+                ethash_destroy_epoch_context_full(context);
+                context = nullptr;
+            }
+        }
+
+        if (context == nullptr && light_record != nullptr)
+        {
+            light_record->release();
+            light_record = nullptr;
+        }
+
+        if (context != nullptr)
+        {
+            const auto build_time_ns = elapsed_ns(start_time);
+            (full ? num_full_builds : num_light_builds).fetch_add(1, std::memory_order_relaxed);
+            (full ? full_build_time_ns : light_build_time_ns)
+                .fetch_add(build_time_ns, std::memory_order_relaxed);
+            (full ? last_full_build_time_ns : last_light_build_time_ns)
+                .store(build_time_ns, std::memory_order_relaxed);
+        }
+
+        lock_shared_contexts(lock);
+        context_record* record = nullptr;
+        if (context != nullptr)
+        {
+            if (prepare)
+            {
+                // Keep only the most recently used full context besides the new one.
+                while (true)
+                {
+                    const context_record* lru = nullptr;
+                    int num_full = 0;
+                    for (auto& slot : published_contexts)
+                    {
+                        const auto* r = slot.load(std::memory_order_relaxed);
+                        if (r == nullptr || r->key.load(std::memory_order_relaxed) % 2 == 0)
+                            continue;
+                        ++num_full;
+                        if (lru == nullptr || r->last_used.load(std::memory_order_relaxed) <
+                                                  lru->last_used.load(std::memory_order_relaxed))
+                            lru = r;
+                    }
+                    if (num_full < max_num_full_contexts)
+                        break;
+                    const int lru_key = lru->key.load(std::memory_order_relaxed);
+                    evict_full_contexts([lru_key](int e) noexcept { return e == lru_key / 2; });
+                }
+            }
+            else if (full)
+                evict_full_contexts([](int) noexcept { return true; });
+
+            record = publish(key, context, light_record);
+            if (record == nullptr)
+            {
+                ethash_destroy_epoch_context_full(context);
+                if (light_record != nullptr)
+                    light_record->release();
+            }
+        }
+        reserved_memory_size -= memory_size;
+        pending_builds.erase(key);
+        lock.unlock();
+        build_finished_cv.notify_all();
+        return record;
+    }
+}
+
+/// The background builder of shared contexts.
+///
+/// The worker thread is started on the first request. At exit the build in progress
+/// is cancelled, so joining the worker does not wait for the full dataset generation.
+class context_prefetcher
+{
+public:
+    context_prefetcher() noexcept = default;
+
+    ~context_prefetcher() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stop = true;
+        }
+        m_cancelled.store(true, std::memory_order_relaxed);
+        m_cv.notify_one();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    context_prefetcher(const context_prefetcher&) = delete;
+    context_prefetcher& operator=(const context_prefetcher&) = delete;
+
+    /// Requests building the context of the given key, see get_shared_context().
+    /// The request is dropped in case of failure.
+    void request(int key, int num_threads = 0) noexcept
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (std::find_if(m_requests.begin(), m_requests.end(),
+                    [key](const prefetch_request& r) noexcept { return r.key == key; }) !=
+                m_requests.end())
+                return;
+            m_requests.push_back({key, num_threads});
+            if (!m_thread.joinable())
+                m_thread = std::thread{&context_prefetcher::run, this};
+        }
+        catch (...)
+        {
+            return;
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    void run() noexcept
     {
-        // Release the shared pointer of the obsoleted context.
-        shared_context.reset();
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_cv.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+            if (m_stop)
+                return;
+            const auto request = m_requests.front();
+            m_requests.pop_front();
+            lock.unlock();
 
-        // Build new context.
-        shared_context = create_epoch_context(epoch_number);
+            // This is background work.
+            lower_thread_priority();
+
+            // Build and publish the context, the reference is not needed.
+            // In case of failure the context will be built on demand.
+            if (auto* record = get_shared_context(request.key, request.num_threads, &m_cancelled))
+                record->release();
+        }
     }
 
-    thread_local_context = shared_context;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    struct prefetch_request
+    {
+        int key;
+        int num_threads;
+    };
+
+    std::deque<prefetch_request> m_requests;
+    std::thread m_thread;
+    bool m_stop = false;
+
+    /// Cancels the build in progress at exit.
+    std::atomic<bool> m_cancelled{false};
+};
+
+/// The builders of the light and the full contexts. The light contexts are built separately,
+/// so they do not wait for the full dataset generation.
+context_prefetcher light_prefetcher;
+context_prefetcher full_prefetcher;
+
+/// The distance in blocks to the next epoch at which its context is prefetched.
+/// Zero disables the automatic prefetching.
+std::atomic<int> prefetch_distance{0};
+
+/// The latest epoch prefetched automatically.
+std::atomic<int> last_prefetched_epoch{-1};
+
+/// Finds the shared context of the given key if it has already been built. Lock-free.
+template <typename Context>
+inline const Context* find_shared_context(context_handle<Context>& local, int key) noexcept
+{
+    register_thread_stats();
+
+    auto* const record = find_published(key);
+    if (record == nullptr)
+        return nullptr;
+
+    num_shared_hits.fetch_add(1, std::memory_order_relaxed);
+    local.reset(record);
+    return local.get();
 }
 
-ATTRIBUTE_NOINLINE
-void update_local_context_full(int epoch_number)
+/// Update thread local epoch context.
+void update_local_context(int epoch_number) noexcept
+{
+    ETHASH_TRACE2(update_local_context_start, epoch_number, false);
+    register_thread_stats();
+
+    // Release the reference to the obsoleted context.
+    thread_local_context.reset();
+    thread_local_context.reset(get_shared_context(context_record::make_key(epoch_number, false)));
+    ETHASH_TRACE3(update_local_context_end, epoch_number, false, thread_local_context.get());
+}
+
+/// Evicts the full contexts of the epochs older than the given one after a thread has switched
+/// to the full context of the given epoch.
+void evict_older_full_contexts(int epoch_number) noexcept
+{
+    const auto is_older = [epoch_number](int e) noexcept { return e < epoch_number; };
+
+    // Check without locking first, this is the common case.
+    const bool found = std::any_of(std::begin(published_contexts), std::end(published_contexts),
+        [&](const std::atomic<context_record*>& slot) noexcept {
+            const auto* record = slot.load(std::memory_order_acquire);
+            if (record == nullptr)
+                return false;
+            const int key = record->key.load(std::memory_order_relaxed);
+            return key % 2 != 0 && is_older(key / 2);
+        });
+    if (!found)
+        return;
+
+    const auto lock = lock_shared_contexts();
+    evict_full_contexts(is_older);
+}
+
+void update_local_context_full(int epoch_number) noexcept
 {
-    // Release the shared pointer of the obsoleted context.
+    ETHASH_TRACE2(update_local_context_start, epoch_number, true);
+    register_thread_stats();
+
+    // Release the reference to the obsoleted context.
     thread_local_context_full.reset();
+    thread_local_context_full.reset(get_shared_context(context_record::make_key(epoch_number, true)));
+    if (thread_local_context_full)
+        evict_older_full_contexts(epoch_number);
+    ETHASH_TRACE3(update_local_context_end, epoch_number, true, thread_local_context_full.get());
+}
 
-    // Local context invalid, check the shared context.
-    std::lock_guard<std::mutex> lock{shared_context_full_mutex};
+/// Finds the full context of the given epoch if it has already been built and its full dataset
+/// has been completely generated, so the lookups do not race with the lazy generation.
+///
+/// The returned reference is scoped to the verification. It does not go to the thread-local
+/// handle, so verifying threads do not keep the full dataset alive after it is evicted.
+inline context_handle<epoch_context_full> find_context_full(int epoch_number) noexcept
+{
+    register_thread_stats();
 
-    if (!shared_context_full || shared_context_full->epoch_number != epoch_number)
-    {
-        // Release the shared pointer of the obsoleted context.
-        shared_context_full.reset();
+    context_handle<epoch_context_full> context;
+    context.reset(find_published(context_record::make_key(epoch_number, true)));
+    if (!context)
+        return context;
 
-        // Build new context.
-        shared_context_full = create_epoch_context_full(epoch_number);
+    if (!context->full_dataset_generated.load(std::memory_order_acquire))
+    {
+        context.reset();
+        return context;
     }
 
-    thread_local_context_full = shared_context_full;
+    num_shared_hits.fetch_add(1, std::memory_order_relaxed);
+    return context;
 }
+
+/// The global shared contexts as the source of verify_with_source().
+struct global_contexts
+{
+    context_handle<epoch_context_full> find_full(int epoch_number) const noexcept
+    {
+        return find_context_full(epoch_number);
+    }
+
+    const epoch_context* get_light(int epoch_number) const noexcept
+    {
+        return ethash_get_global_epoch_context(epoch_number);
+    }
+};
+
 }  // namespace
 
+void ethash_global_context_set_capacity(int max_num_epochs, size_t memory_budget) noexcept
+{
+    const auto lock = lock_shared_contexts();
+    shared_contexts_max_size =
+        std::min(std::max(max_num_epochs, 1), max_num_published_contexts - max_num_full_contexts);
+    shared_contexts_memory_budget = memory_budget;
+    evict_shared_contexts(0, 0);
+}
+
+void ethash_global_context_prefetch(int epoch_number) noexcept
+{
+    if (epoch_number < 0 || epoch_number > max_epoch_number)
+        return;
+
+    const int key = context_record::make_key(epoch_number, false);
+    auto* const record = find_published(key);
+    if (record != nullptr)
+    {
+        record->release();
+        return;
+    }
+
+    light_prefetcher.request(key);
+}
+
+bool ethash_global_context_prepare_full(int epoch_number, int num_threads) noexcept
+{
+    if (epoch_number < 0 || epoch_number > max_epoch_number)
+        return false;
+
+    const int key = context_record::make_key(epoch_number, true);
+    {
+        const auto lock = lock_shared_contexts();
+        if (auto* record = find_published(key))
+        {
+            record->release();
+            return true;
+        }
+        if (pending_builds.count(key) != 0)
+            return true;
+        if (!fits_full_memory_limit(epoch_number) ||
+            !fits_memory_budget(get_context_full_memory_size(epoch_number)))
+            return false;
+    }
+
+    if (num_threads <= 0)
+        num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    full_prefetcher.request(key, num_threads);
+    return true;
+}
+
+void ethash_global_context_set_full_memory_limit(size_t memory_limit) noexcept
+{
+    const auto lock = lock_shared_contexts();
+    full_contexts_memory_limit = memory_limit;
+}
+
+void ethash_global_context_set_prefetch_distance(int num_blocks) noexcept
+{
+    prefetch_distance.store(std::max(num_blocks, 0), std::memory_order_relaxed);
+}
+
+void ethash_global_context_update_head(int block_number) noexcept
+{
+    const int distance = prefetch_distance.load(std::memory_order_relaxed);
+    if (distance == 0 || block_number < 0)
+        return;
+
+    const int next_epoch_number = get_epoch_number(block_number) + 1;
+    if (next_epoch_number > max_epoch_number ||
+        next_epoch_number * ETHASH_EPOCH_LENGTH - block_number > distance)
+        return;
+
+    // Prefetch each epoch once, also when many threads report the head concurrently.
+    int e = last_prefetched_epoch.load(std::memory_order_relaxed);
+    while (e < next_epoch_number)
+    {
+        if (last_prefetched_epoch.compare_exchange_weak(e, next_epoch_number))
+        {
+            ethash_global_context_prefetch(next_epoch_number);
+            break;
+        }
+    }
+}
+
+void ethash_global_context_set_memory_budget(size_t memory_budget) noexcept
+{
+    const auto lock = lock_shared_contexts();
+    total_memory_budget = memory_budget;
+    reserve_memory(0);
+}
+
+size_t ethash_global_context_get_memory_size() noexcept
+{
+    return allocated_memory_size.load(std::memory_order_relaxed);
+}
+
+size_t ethash_global_context_get_memory_usage(
+    ethash_global_context_memory_usage* entries, size_t max_num_entries) noexcept
+{
+    const auto lock = lock_shared_contexts();
+
+    size_t num_entries = 0;
+    for (const auto& record : context_records)
+    {
+        // The records being released have the key reset, skip them.
+        const int key = record.key.load(std::memory_order_relaxed);
+        if (!record.in_use.load(std::memory_order_acquire) || key < 0)
+            continue;
+
+        if (num_entries < max_num_entries)
+        {
+            const bool cached = std::any_of(std::begin(published_contexts),
+                std::end(published_contexts), [&record](const std::atomic<context_record*>& slot) {
+                    return slot.load(std::memory_order_relaxed) == &record;
+                });
+            entries[num_entries] = {key / 2, key % 2 != 0, cached, record.memory_size};
+        }
+        ++num_entries;
+    }
+    return num_entries;
+}
+
+ethash_global_context_stats ethash_global_context_get_stats() noexcept
+{
+    ethash_global_context_stats stats{};
+    {
+        std::lock_guard<std::mutex> lock{thread_stats_mutex};
+        stats.thread_local_hits = num_retired_thread_local_hits.load(std::memory_order_relaxed);
+        for (const auto* t = thread_stats_list; t != nullptr; t = t->next)
+            stats.thread_local_hits += t->thread_local_hits->load(std::memory_order_relaxed);
+    }
+    stats.shared_hits = num_shared_hits.load(std::memory_order_relaxed);
+    stats.misses = num_misses.load(std::memory_order_relaxed);
+    stats.light_builds = num_light_builds.load(std::memory_order_relaxed);
+    stats.light_build_time_ns = light_build_time_ns.load(std::memory_order_relaxed);
+    stats.last_light_build_time_ns = last_light_build_time_ns.load(std::memory_order_relaxed);
+    stats.full_builds = num_full_builds.load(std::memory_order_relaxed);
+    stats.full_build_time_ns = full_build_time_ns.load(std::memory_order_relaxed);
+    stats.last_full_build_time_ns = last_full_build_time_ns.load(std::memory_order_relaxed);
+    stats.lock_waits = num_lock_waits.load(std::memory_order_relaxed);
+    stats.lock_wait_time_ns = lock_wait_time_ns.load(std::memory_order_relaxed);
+    stats.memory_size = allocated_memory_size.load(std::memory_order_relaxed);
+    return stats;
+}
+
 const ethash_epoch_context* ethash_get_global_epoch_context(int epoch_number) noexcept
 {
     // Check if local context matches epoch number.
-    if (!thread_local_context || thread_local_context->epoch_number != epoch_number)
+    if (thread_local_context && thread_local_context->epoch_number == epoch_number)
+        record_thread_local_hit();
+    else
         update_local_context(epoch_number);
 
     return thread_local_context.get();
@@ -93,8 +1126,227 @@ const ethash_epoch_context* ethash_get_global_epoch_context(int epoch_number) no
 const ethash_epoch_context_full* ethash_get_global_epoch_context_full(int epoch_number) noexcept
 {
     // Check if local context matches epoch number.
-    if (!thread_local_context_full || thread_local_context_full->epoch_number != epoch_number)
+    if (thread_local_context_full && thread_local_context_full->epoch_number == epoch_number)
+        record_thread_local_hit();
+    else
         update_local_context_full(epoch_number);
 
     return thread_local_context_full.get();
 }
+
+const ethash_epoch_context* ethash_try_get_global_epoch_context(int epoch_number) noexcept
+{
+    if (thread_local_context && thread_local_context->epoch_number == epoch_number)
+    {
+        record_thread_local_hit();
+        return thread_local_context.get();
+    }
+
+    return find_shared_context(thread_local_context, context_record::make_key(epoch_number, false));
+}
+
+const ethash_epoch_context_full* ethash_try_get_global_epoch_context_full(
+    int epoch_number) noexcept
+{
+    if (thread_local_context_full && thread_local_context_full->epoch_number == epoch_number)
+    {
+        record_thread_local_hit();
+        return thread_local_context_full.get();
+    }
+
+    return find_shared_context(
+        thread_local_context_full, context_record::make_key(epoch_number, true));
+}
+
+const ethash_epoch_context* ethash_epoch_context_acquire(int epoch_number) noexcept
+{
+    auto* const record = get_shared_context(context_record::make_key(epoch_number, false));
+    return record != nullptr ? record->context : nullptr;
+}
+
+const ethash_epoch_context_full* ethash_epoch_context_full_acquire(int epoch_number) noexcept
+{
+    auto* const record = get_shared_context(context_record::make_key(epoch_number, true));
+    if (record == nullptr)
+        return nullptr;
+    evict_older_full_contexts(epoch_number);
+    return record->context;
+}
+
+void ethash_epoch_context_release(const ethash_epoch_context* context) noexcept
+{
+    if (context == nullptr)
+        return;
+
+    context_record* record = nullptr;
+    {
+        const auto lock = lock_shared_contexts();
+        // The record is referenced by the caller so it cannot be reused concurrently.
+        // Skip the records having released their contexts, the memory could have been reused.
+        const auto it = std::find_if(context_records.begin(), context_records.end(),
+            [context](const context_record& r) noexcept {
+                return r.in_use.load(std::memory_order_acquire) && r.context == context &&
+                       r.num_refs.load(std::memory_order_relaxed) != 0;
+            });
+        if (it != context_records.end())
+            record = &*it;
+    }
+
+    // Drop the reference without holding the lock, this may destroy the context.
+    if (record != nullptr)
+        record->release();
+}
+
+void ethash_epoch_context_full_release(const ethash_epoch_context_full* context) noexcept
+{
+    ethash_epoch_context_release(context);
+}
+
+void ethash_global_context_purge_thread_local() noexcept
+{
+    thread_local_context.reset();
+    thread_local_context_full.reset();
+}
+
+ethash_errc ethash_verify_against_boundary_global(int epoch_number,
+    const ethash_hash256* header_hash, const ethash_hash256* mix_hash, uint64_t nonce,
+    const ethash_hash256* boundary) noexcept
+{
+    return verify_with_source(global_contexts{}, epoch_number,
+        boundary_criterion{*header_hash, *mix_hash, nonce, *boundary});
+}
+
+ethash_errc ethash_verify_against_difficulty_global(int epoch_number,
+    const ethash_hash256* header_hash, const ethash_hash256* mix_hash, uint64_t nonce,
+    const ethash_hash256* difficulty) noexcept
+{
+    return verify_with_source(global_contexts{}, epoch_number,
+        difficulty_criterion{*header_hash, *mix_hash, nonce, *difficulty});
+}
+
+ethash_errc ethash_verify_against_target_global(int epoch_number,
+    const ethash_hash256* header_hash, const ethash_hash256* mix_hash, uint64_t nonce,
+    const ethash_target* target) noexcept
+{
+    return verify_with_source(global_contexts{}, epoch_number,
+        target_criterion{*header_hash, *mix_hash, nonce, *target});
+}
+
+ethash_errc ethash_verify_header_global(const uint8_t* header, size_t header_size) noexcept
+{
+    ethash_header_seal seal;
+    const auto ec = ethash_decode_header_seal(header, header_size, &seal);
+    if (ec != ETHASH_SUCCESS)
+        return ec;
+
+    return ethash_verify_against_difficulty_global(get_epoch_number(seal.block_number),
+        &seal.header_hash, &seal.mix_hash, seal.nonce, &seal.difficulty);
+}
+
+void ethash_verify_batch(const ethash_header_seal* seals, size_t num_seals, ethash_errc* results,
+    int num_threads) noexcept
+{
+    if (num_threads <= 0)
+        num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    // Check the final hashes first, this is cheap and does not require the epoch context.
+    // The seals are checked in chunks. Within a chunk the difficulty shared with the next seal
+    // is converted to the target once and the following seals are checked against it.
+    constexpr size_t chunk_size = 64;
+    const size_t num_chunks = (num_seals + chunk_size - 1) / chunk_size;
+    pool_parallel_for(num_chunks, num_threads, [=](size_t c) noexcept {
+        const size_t end = std::min(num_seals, (c + 1) * chunk_size);
+        const hash256* target_difficulty = nullptr;
+        ethash_target target{};
+        for (size_t i = c * chunk_size; i < end; ++i)
+        {
+            const auto& s = seals[i];
+            if (s.block_number < 0 || get_epoch_number(s.block_number) > max_epoch_number)
+            {
+                results[i] = ETHASH_INVALID_EPOCH_NUMBER;
+                continue;
+            }
+
+            if (target_difficulty == nullptr || !equal(*target_difficulty, s.difficulty))
+            {
+                if (i + 1 == end || !equal(s.difficulty, seals[i + 1].difficulty))
+                {
+                    results[i] = ethash_verify_final_hash_against_difficulty(
+                        &s.header_hash, &s.mix_hash, s.nonce, &s.difficulty);
+                    continue;
+                }
+                target = ethash_prepare_target(&s.difficulty);
+                target_difficulty = &s.difficulty;
+            }
+            results[i] = ethash_verify_final_hash_against_target(
+                &s.header_hash, &s.mix_hash, s.nonce, &target);
+        }
+    });
+
+    std::vector<size_t> pending;
+    try
+    {
+        for (size_t i = 0; i < num_seals; ++i)
+        {
+            if (results[i] == ETHASH_SUCCESS)
+                pending.push_back(i);
+        }
+    }
+    catch (...)
+    {
+        // Out of memory, verify the seals one by one.
+        for (size_t i = 0; i < num_seals; ++i)
+        {
+            const auto& s = seals[i];
+            if (results[i] == ETHASH_SUCCESS)
+                results[i] = ethash_verify_against_difficulty_global(get_epoch_number(s.block_number),
+                    &s.header_hash, &s.mix_hash, s.nonce, &s.difficulty);
+        }
+        return;
+    }
+
+    const auto epoch_of = [seals](size_t i) noexcept {
+        return get_epoch_number(seals[i].block_number);
+    };
+    std::stable_sort(pending.begin(), pending.end(),
+        [&](size_t a, size_t b) noexcept { return epoch_of(a) < epoch_of(b); });
+
+    for (auto group_begin = pending.begin(); group_begin != pending.end();)
+    {
+        const int epoch_number = epoch_of(*group_begin);
+        const auto group_end = std::find_if(group_begin, pending.end(),
+            [&](size_t i) noexcept { return epoch_of(i) != epoch_number; });
+        const size_t* const group = &*group_begin;
+        const auto group_size = static_cast<size_t>(group_end - group_begin);
+
+        // The full context is kept alive by the scoped reference for the group, the light one
+        // by the thread-local reference of the calling thread.
+        const auto context_full = find_context_full(epoch_number);
+        if (context_full)
+        {
+            const epoch_context_full* const full = context_full.get();
+            pool_parallel_for(group_size, num_threads, [=](size_t k) noexcept {
+                const auto i = group[k];
+                const auto& s = seals[i];
+                results[i] = ethash_verify_against_difficulty_full(
+                    full, &s.header_hash, &s.mix_hash, s.nonce, &s.difficulty);
+            });
+        }
+        else if (const auto* context = ethash_get_global_epoch_context(epoch_number))
+        {
+            pool_parallel_for(group_size, num_threads, [=](size_t k) noexcept {
+                const auto i = group[k];
+                const auto& s = seals[i];
+                results[i] = ethash_verify_against_difficulty(
+                    context, &s.header_hash, &s.mix_hash, s.nonce, &s.difficulty);
+            });
+        }
+        else
+        {
+            for (size_t k = 0; k < group_size; ++k)
+                results[group[k]] = ETHASH_OUT_OF_MEMORY;
+        }
+
+        group_begin = group_end;
+    }
+}
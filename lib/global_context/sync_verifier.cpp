@@ -0,0 +1,109 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "verify_seal.hpp"
+#include <ethash/sync_verifier.hpp>
+#include <new>
+#include <vector>
+
+namespace ethash
+{
+namespace
+{
+sync_verifier::context_ptr build_context(int epoch_number) noexcept
+{
+    auto context = create_epoch_context(epoch_number);
+    if (!context)
+        return nullptr;
+
+    try
+    {
+        // The deleter destroys the context also if allocating the control block fails.
+        return {context.release(), ethash_destroy_epoch_context};
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+/// The light contexts of the verifier as the source of verify_with_source().
+struct verifier_contexts
+{
+    sync_verifier& verifier;
+
+    const epoch_context_full* find_full(int /*epoch_number*/) const noexcept { return nullptr; }
+
+    sync_verifier::context_ptr get_light(int epoch_number) const noexcept
+    {
+        return verifier.get_context(epoch_number);
+    }
+};
+}  // namespace
+
+sync_verifier::context_future& sync_verifier::get_or_build(int epoch_number)
+{
+    auto it = m_contexts.find(epoch_number);
+    if (it != m_contexts.end())
+        return it->second;
+
+    context_future future;
+    try
+    {
+        future = std::async(std::launch::async, build_context, epoch_number);
+    }
+    catch (const std::system_error&)
+    {
+        // Cannot start a thread, build the context later by the first waiting thread.
+        future = std::async(std::launch::deferred, build_context, epoch_number);
+    }
+    return m_contexts.emplace(epoch_number, std::move(future)).first->second;
+}
+
+sync_verifier::context_ptr sync_verifier::get_context(int epoch_number) noexcept
+{
+    if (epoch_number < 0 || epoch_number > max_epoch_number)
+        return nullptr;
+
+    context_future future;
+    std::vector<context_future> obsolete;
+    try
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if (epoch_number > m_latest_epoch)
+        {
+            m_latest_epoch = epoch_number;
+
+            // Release the contexts older than the previous epoch.
+            for (auto it = m_contexts.begin();
+                 it != m_contexts.end() && it->first < epoch_number - 1;)
+            {
+                obsolete.emplace_back(std::move(it->second));
+                it = m_contexts.erase(it);
+            }
+        }
+
+        future = get_or_build(epoch_number);
+
+        // Prepare the next epoch context in the background.
+        if (epoch_number == m_latest_epoch && epoch_number < max_epoch_number)
+            get_or_build(epoch_number + 1);
+    }
+    catch (const std::bad_alloc&)
+    {
+        if (!future.valid())
+            return build_context(epoch_number);
+    }
+
+    // The obsolete contexts are destroyed on return, outside of the lock.
+    return future.get();
+}
+
+std::error_code sync_verifier::verify(const header_seal& seal) noexcept
+{
+    return verify_with_source(verifier_contexts{*this}, get_seal_epoch_number(seal),
+        difficulty_criterion{seal.header_hash, seal.mix_hash, seal.nonce, seal.difficulty});
+}
+}  // namespace ethash
@@ -0,0 +1,441 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "verify_pool.hpp"
+#include "verify_seal.hpp"
+#include <ethash/global_context.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ethash
+{
+namespace
+{
+constexpr size_t default_max_pending_per_thread = 1024;
+
+/// The loop run by the calling thread and the helping workers, see pool_parallel_for().
+struct parallel_loop
+{
+    parallel_loop(size_t num_iterations, void (*f)(const void*, size_t), const void* a) noexcept
+      : n{num_iterations}, fn{f}, arg{a}
+    {}
+
+    const size_t n;
+    void (*const fn)(const void*, size_t);
+    const void* const arg;
+
+    /// The next iteration to take.
+    std::atomic<size_t> next{0};
+
+    /// The number of finished iterations.
+    std::atomic<size_t> num_done{0};
+
+    std::mutex mutex;
+    std::condition_variable done_cv;
+
+    /// Runs the iterations not taken yet. The fn is only invoked for the iterations taken,
+    /// so the loop can outlive the caller's fn and arg.
+    void run() noexcept
+    {
+        size_t num_run = 0;
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+             i = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            fn(arg, i);
+            ++num_run;
+        }
+
+        if (num_run != 0 && num_done.fetch_add(num_run, std::memory_order_acq_rel) + num_run == n)
+        {
+            // Lock the mutex to not miss the caller which is about to wait.
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+            }
+            done_cv.notify_all();
+        }
+    }
+
+    /// Waits for all the iterations to finish.
+    void wait() noexcept
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        done_cv.wait(lock, [this] { return num_done.load(std::memory_order_acquire) == n; });
+    }
+};
+
+struct verify_task
+{
+    header_seal seal;
+    ethash_verify_callback callback;
+    void* user_data;
+
+    /// The loop to help with instead of the seal verification.
+    std::shared_ptr<parallel_loop> loop;
+};
+
+/// The queue of a worker. The owner takes the tasks from the front, the idle workers steal
+/// the tasks from the back.
+struct worker_queue
+{
+    std::mutex mutex;
+    std::deque<verify_task> tasks;
+};
+
+/// The pool of worker threads verifying the seals queued by ethash_verify_async().
+class verify_pool
+{
+public:
+    verify_pool(int num_threads, size_t max_pending);
+    ~verify_pool() noexcept;
+
+    verify_pool(const verify_pool&) = delete;
+    verify_pool& operator=(const verify_pool&) = delete;
+
+    /// Queues the task. Returns false if the limit of pending tasks has been reached.
+    bool submit(const verify_task& task) noexcept;
+
+    /// Queues the requests for up to the given number of workers to help with the loop.
+    /// These are not limited and not counted as pending verifications. The workers take them
+    /// before the queued verifications, so the calling thread gets help also under load.
+    void help(const std::shared_ptr<parallel_loop>& loop, size_t num_helpers) noexcept;
+
+    size_t num_threads() const noexcept { return m_threads.size(); }
+
+    size_t num_pending() const noexcept { return m_num_pending.load(std::memory_order_relaxed); }
+
+private:
+    /// Pushes the task to the next queue in the round-robin order.
+    bool push(const verify_task& task) noexcept;
+
+    /// Takes the request to help with a loop, otherwise the task from the worker's own queue
+    /// or steals it from other queues.
+    bool try_pop(size_t worker, verify_task& task) noexcept;
+
+    void run(size_t worker) noexcept;
+
+    /// Stops the workers after the queued tasks are finished.
+    void stop() noexcept;
+
+    const size_t m_max_pending;
+
+    /// The number of tasks queued or being verified.
+    std::atomic<size_t> m_num_pending{0};
+
+    /// The number of tasks queued. The idle workers wait for it to become positive.
+    std::atomic<size_t> m_num_queued{0};
+
+    /// The round-robin counter distributing the submitted tasks over the queues.
+    std::atomic<size_t> m_next_queue{0};
+
+    std::vector<std::unique_ptr<worker_queue>> m_queues;
+
+    /// The requests to help with loops, taken before the verification tasks.
+    worker_queue m_loop_queue;
+
+    /// The number of requests in m_loop_queue, to skip locking it when empty.
+    std::atomic<size_t> m_num_loops_queued{0};
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_idle_mutex;
+    std::condition_variable m_idle_cv;
+
+    /// The pool is being destroyed. Guarded by m_idle_mutex.
+    bool m_stop = false;
+};
+
+verify_pool::verify_pool(int num_threads, size_t max_pending) : m_max_pending{max_pending}
+{
+    const auto n = static_cast<size_t>(num_threads);
+    m_queues.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        m_queues.emplace_back(new worker_queue);
+
+    m_threads.reserve(n);
+    try
+    {
+        for (size_t i = 0; i < n; ++i)
+            m_threads.emplace_back(&verify_pool::run, this, i);
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+}
+
+verify_pool::~verify_pool() noexcept
+{
+    stop();
+}
+
+void verify_pool::stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock{m_idle_mutex};
+        m_stop = true;
+    }
+    m_idle_cv.notify_all();
+
+    for (auto& t : m_threads)
+        t.join();
+    m_threads.clear();
+}
+
+bool verify_pool::submit(const verify_task& task) noexcept
+{
+    size_t n = m_num_pending.load(std::memory_order_relaxed);
+    do
+    {
+        if (n >= m_max_pending)
+            return false;
+    } while (!m_num_pending.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+
+    if (!push(task))
+    {
+        m_num_pending.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Lock the mutex to not miss the worker which has just checked the queues and is about
+    // to wait.
+    {
+        std::lock_guard<std::mutex> lock{m_idle_mutex};
+    }
+    m_idle_cv.notify_one();
+    return true;
+}
+
+void verify_pool::help(const std::shared_ptr<parallel_loop>& loop, size_t num_helpers) noexcept
+{
+    verify_task task{};
+    task.loop = loop;
+    size_t num_pushed = 0;
+    {
+        std::lock_guard<std::mutex> lock{m_loop_queue.mutex};
+        try
+        {
+            for (; num_pushed < num_helpers; ++num_pushed)
+                m_loop_queue.tasks.push_back(task);
+        }
+        catch (...)
+        {
+            // Out of memory, go with the helpers queued so far.
+        }
+        m_num_loops_queued.fetch_add(num_pushed, std::memory_order_relaxed);
+    }
+
+    if (num_pushed == 0)
+        return;
+    m_num_queued.fetch_add(num_pushed, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock{m_idle_mutex};
+    }
+    m_idle_cv.notify_all();
+}
+
+bool verify_pool::push(const verify_task& task) noexcept
+{
+    const size_t queue_index = m_next_queue.fetch_add(1, std::memory_order_relaxed);
+    auto& queue = *m_queues[queue_index % m_queues.size()];
+    try
+    {
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.tasks.push_back(task);
+    }
+    catch (...)
+    {
+        return false;
+    }
+    m_num_queued.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool verify_pool::try_pop(size_t worker, verify_task& task) noexcept
+{
+    if (m_num_loops_queued.load(std::memory_order_relaxed) != 0)
+    {
+        std::lock_guard<std::mutex> lock{m_loop_queue.mutex};
+        if (!m_loop_queue.tasks.empty())
+        {
+            task = m_loop_queue.tasks.front();
+            m_loop_queue.tasks.pop_front();
+            m_num_loops_queued.fetch_sub(1, std::memory_order_relaxed);
+            m_num_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    for (size_t i = 0; i < m_queues.size(); ++i)
+    {
+        const bool own = i == 0;
+        auto& queue = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        if (queue.tasks.empty())
+            continue;
+
+        if (own)
+        {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        else
+        {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        m_num_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void verify_pool::run(size_t worker) noexcept
+{
+    while (true)
+    {
+        verify_task task{};
+        if (try_pop(worker, task))
+        {
+            if (task.loop)
+            {
+                task.loop->run();
+                continue;
+            }
+
+            const auto& s = task.seal;
+            const auto result = ethash_verify_against_difficulty_global(
+                get_seal_epoch_number(s), &s.header_hash, &s.mix_hash, s.nonce,
+                &s.difficulty);
+            task.callback(&s, result, task.user_data);
+            m_num_pending.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Do not keep the contexts of old epochs alive while idle.
+        ethash_global_context_purge_thread_local();
+
+        std::unique_lock<std::mutex> lock{m_idle_mutex};
+        m_idle_cv.wait(
+            lock, [this] { return m_stop || m_num_queued.load(std::memory_order_acquire) != 0; });
+        if (m_stop && m_num_queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+/// The pool is started on first use and destroyed (after finishing the queued verifications)
+/// at exit, before the global shared contexts it uses.
+struct pool_holder
+{
+    std::mutex mutex;
+    std::atomic<verify_pool*> pool{nullptr};
+    std::unique_ptr<verify_pool> pool_owner;
+    int num_threads = 0;
+    size_t max_pending = 0;
+};
+
+pool_holder& get_pool_holder() noexcept
+{
+    static pool_holder holder;
+    return holder;
+}
+
+verify_pool* get_pool() noexcept
+{
+    auto& holder = get_pool_holder();
+    if (auto* pool = holder.pool.load(std::memory_order_acquire))
+        return pool;
+
+    std::lock_guard<std::mutex> lock{holder.mutex};
+    if (holder.pool_owner)
+        return holder.pool_owner.get();
+
+    int num_threads = holder.num_threads;
+    if (num_threads <= 0)
+        num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    size_t max_pending = holder.max_pending;
+    if (max_pending == 0)
+        max_pending = default_max_pending_per_thread * static_cast<size_t>(num_threads);
+    try
+    {
+        holder.pool_owner.reset(new verify_pool{num_threads, max_pending});
+    }
+    catch (...)
+    {
+        return nullptr;  // Cannot start the threads, try again next time.
+    }
+    holder.pool.store(holder.pool_owner.get(), std::memory_order_release);
+    return holder.pool_owner.get();
+}
+}  // namespace
+
+void pool_parallel_for(
+    size_t n, int num_threads, void (*fn)(const void* arg, size_t i), const void* arg) noexcept
+{
+    std::shared_ptr<parallel_loop> loop;
+    if (n > 1 && num_threads > 1)
+    {
+        if (auto* const pool = get_pool())
+        {
+            try
+            {
+                loop = std::make_shared<parallel_loop>(n, fn, arg);
+            }
+            catch (...)
+            {
+                // Out of memory, run the loop in the calling thread.
+            }
+            if (loop)
+            {
+                const auto num_helpers = std::min(
+                    {static_cast<size_t>(num_threads - 1), pool->num_threads(), n - 1});
+                pool->help(loop, num_helpers);
+                loop->run();
+                loop->wait();
+                return;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        fn(arg, i);
+}
+}  // namespace ethash
+
+using namespace ethash;
+
+extern "C" {
+
+bool ethash_verify_async_configure(int num_threads, size_t max_pending) noexcept
+{
+    auto& holder = get_pool_holder();
+    std::lock_guard<std::mutex> lock{holder.mutex};
+    if (holder.pool_owner)
+        return false;
+    holder.num_threads = num_threads;
+    holder.max_pending = max_pending;
+    return true;
+}
+
+bool ethash_verify_async(
+    const ethash_header_seal* seal, ethash_verify_callback callback, void* user_data) noexcept
+{
+    auto* const pool = get_pool();
+    return pool != nullptr && pool->submit({*seal, callback, user_data, {}});
+}
+
+size_t ethash_verify_async_get_num_pending() noexcept
+{
+    const auto* const pool = get_pool_holder().pool.load(std::memory_order_acquire);
+    return pool != nullptr ? pool->num_pending() : 0;
+}
+
+}  // extern "C"
@@ -0,0 +1,30 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The access to the worker pool of ethash_verify_async() for other parallel work.
+
+#pragma once
+
+#include <cstddef>
+
+namespace ethash
+{
+/// Runs fn(arg, i) for all i in [0, n) using the calling thread and up to num_threads - 1
+/// workers of the pool of ethash_verify_async().
+///
+/// The workers join the loop when they get to it after the verifications queued before,
+/// the calling thread runs the iterations not taken by them. It returns when all
+/// the iterations are finished.
+void pool_parallel_for(
+    size_t n, int num_threads, void (*fn)(const void* arg, size_t i), const void* arg) noexcept;
+
+/// Runs fn(i) for all i in [0, n), see pool_parallel_for() above. The fn must not throw.
+template <typename Fn>
+inline void pool_parallel_for(size_t n, int num_threads, const Fn& fn) noexcept
+{
+    pool_parallel_for(
+        n, num_threads, [](const void* f, size_t i) { (*static_cast<const Fn*>(f))(i); }, &fn);
+}
+}  // namespace ethash
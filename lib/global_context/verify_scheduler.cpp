@@ -0,0 +1,307 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "verify_seal.hpp"
+#include <ethash/verify_scheduler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ethash
+{
+namespace
+{
+using clock = std::chrono::steady_clock;
+
+struct queue_node
+{
+    std::atomic<queue_node*> next{nullptr};
+};
+
+struct verify_request : queue_node
+{
+    verify_request(const header_seal& s, verify_scheduler::callback&& c) noexcept
+      : seal{s}, cb{std::move(c)}
+    {}
+
+    const header_seal seal;
+    const verify_scheduler::callback cb;
+    const clock::time_point submit_time = clock::now();
+};
+
+/// The intrusive multi-producer single-consumer queue (by Dmitry Vyukov).
+///
+/// The push() is lock-free and wait-free. The pop() must not be called concurrently.
+/// It returns null also when a push is in progress and the queue is about to become non-empty.
+class mpsc_queue
+{
+public:
+    mpsc_queue() noexcept = default;
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    void push(queue_node* node) noexcept
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        auto* const prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    queue_node* pop() noexcept
+    {
+        auto* tail = m_tail;
+        auto* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &m_stub)
+        {
+            if (next == nullptr)
+                return nullptr;
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr)
+        {
+            m_tail = next;
+            return tail;
+        }
+
+        if (tail != m_head.load(std::memory_order_acquire))
+            return nullptr;  // The push is in progress.
+
+        // The tail is the last node, put the stub behind it to be able to take it out.
+        push(&m_stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return nullptr;
+        m_tail = next;
+        return tail;
+    }
+
+private:
+    queue_node m_stub;
+    std::atomic<queue_node*> m_head{&m_stub};
+    queue_node* m_tail = &m_stub;
+};
+
+struct class_counters
+{
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> total_queue_time_ns{0};
+    std::atomic<uint64_t> total_latency_ns{0};
+    std::atomic<uint64_t> max_latency_ns{0};
+};
+
+inline bool is_valid_priority(verify_scheduler::priority p) noexcept
+{
+    return p >= 0 && p < verify_scheduler::num_priorities;
+}
+
+inline uint64_t to_ns(clock::duration d) noexcept
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+}  // namespace
+
+struct verify_scheduler::state
+{
+    explicit state(int num_threads);
+    ~state() noexcept;
+
+    /// Takes the oldest request of the most urgent non-empty class.
+    verify_request* pop(int& priority_class) noexcept;
+
+    void run() noexcept;
+
+    /// Stops the workers after the queued requests are finished.
+    void stop() noexcept;
+
+    mpsc_queue queues[num_priorities];
+    class_counters counters[num_priorities];
+
+    /// Serializes the consumers of the queues.
+    std::mutex pop_mutex;
+
+    /// The number of queued requests, including the ones being pushed.
+    std::atomic<size_t> num_queued{0};
+
+    /// The number of completed pushes. The workers which have found the queues empty wait
+    /// for it to change.
+    std::atomic<uint64_t> num_pushed{0};
+
+    std::vector<std::thread> threads;
+
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+
+    /// The scheduler is being destroyed. Guarded by idle_mutex.
+    bool stopping = false;
+};
+
+verify_scheduler::state::state(int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    const auto n = static_cast<size_t>(num_threads);
+    threads.reserve(n);
+    try
+    {
+        for (size_t i = 0; i < n; ++i)
+            threads.emplace_back(&state::run, this);
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+}
+
+verify_scheduler::state::~state() noexcept
+{
+    stop();
+}
+
+void verify_scheduler::state::stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock{idle_mutex};
+        stopping = true;
+    }
+    idle_cv.notify_all();
+
+    for (auto& t : threads)
+        t.join();
+    threads.clear();
+}
+
+verify_request* verify_scheduler::state::pop(int& priority_class) noexcept
+{
+    std::lock_guard<std::mutex> lock{pop_mutex};
+    for (int p = 0; p < num_priorities; ++p)
+    {
+        if (auto* const node = queues[p].pop())
+        {
+            num_queued.fetch_sub(1, std::memory_order_relaxed);
+            priority_class = p;
+            return static_cast<verify_request*>(node);
+        }
+    }
+    return nullptr;
+}
+
+void verify_scheduler::state::run() noexcept
+{
+    while (true)
+    {
+        const auto pushed = num_pushed.load(std::memory_order_acquire);
+
+        int p = 0;
+        if (auto* const request = pop(p))
+        {
+            const auto& seal = request->seal;
+            const auto start_time = clock::now();
+            const std::error_code ec = ethash_verify_against_difficulty_global(
+                get_seal_epoch_number(seal), &seal.header_hash, &seal.mix_hash, seal.nonce,
+                &seal.difficulty);
+            const auto end_time = clock::now();
+
+            auto& c = counters[p];
+            const auto latency = to_ns(end_time - request->submit_time);
+            c.total_queue_time_ns.fetch_add(
+                to_ns(start_time - request->submit_time), std::memory_order_relaxed);
+            c.total_latency_ns.fetch_add(latency, std::memory_order_relaxed);
+            uint64_t max_latency = c.max_latency_ns.load(std::memory_order_relaxed);
+            while (max_latency < latency && !c.max_latency_ns.compare_exchange_weak(max_latency,
+                                                latency, std::memory_order_relaxed))
+            {
+            }
+            c.completed.fetch_add(1, std::memory_order_relaxed);
+
+            request->cb(seal, ec);
+            delete request;
+            continue;
+        }
+
+        // Do not keep the contexts of old epochs alive while idle. Skip this if the queues
+        // are empty only because a request is being pushed.
+        if (num_queued.load(std::memory_order_acquire) == 0)
+            ethash_global_context_purge_thread_local();
+
+        // Wait for the next completed push, including the one in progress.
+        std::unique_lock<std::mutex> lock{idle_mutex};
+        idle_cv.wait(lock, [this, pushed] {
+            return stopping || num_pushed.load(std::memory_order_acquire) != pushed;
+        });
+        if (stopping && num_queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+verify_scheduler::verify_scheduler(int num_threads) : m_state{new state{num_threads}} {}
+
+verify_scheduler::~verify_scheduler() noexcept = default;
+
+bool verify_scheduler::submit(const header_seal& seal, priority p, callback cb) noexcept
+{
+    if (!is_valid_priority(p))
+        return false;
+
+    verify_request* request = nullptr;
+    try
+    {
+        request = new verify_request{seal, std::move(cb)};
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    auto& s = *m_state;
+    s.counters[p].submitted.fetch_add(1, std::memory_order_relaxed);
+    s.num_queued.fetch_add(1, std::memory_order_release);
+    s.queues[p].push(request);
+    s.num_pushed.fetch_add(1, std::memory_order_release);
+
+    // Lock the mutex to not miss the worker which has just checked the queues and is about
+    // to wait.
+    {
+        std::lock_guard<std::mutex> lock{s.idle_mutex};
+    }
+    s.idle_cv.notify_one();
+    return true;
+}
+
+std::future<std::error_code> verify_scheduler::verify(const header_seal& seal, priority p)
+{
+    auto promise = std::make_shared<std::promise<std::error_code>>();
+    auto future = promise->get_future();
+    if (!is_valid_priority(p))
+        promise->set_value(std::make_error_code(std::errc::invalid_argument));
+    else if (!submit(seal, p, [promise](const header_seal&, std::error_code ec) noexcept {
+            promise->set_value(ec);
+        }))
+        promise->set_value(make_error_code(ETHASH_OUT_OF_MEMORY));
+    return future;
+}
+
+verify_scheduler::class_stats verify_scheduler::get_stats(priority p) const noexcept
+{
+    if (!is_valid_priority(p))
+        return {};
+
+    const auto& c = m_state->counters[p];
+    return {c.submitted.load(std::memory_order_relaxed), c.completed.load(std::memory_order_relaxed),
+        c.total_queue_time_ns.load(std::memory_order_relaxed),
+        c.total_latency_ns.load(std::memory_order_relaxed),
+        c.max_latency_ns.load(std::memory_order_relaxed)};
+}
+}  // namespace ethash
@@ -0,0 +1,137 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The verification logic shared by the verification entry points of the global context library.
+
+#pragma once
+
+#include "../ethash/ethash-internal.hpp"
+
+namespace ethash
+{
+/// Returns the epoch number of the block of the seal or -1 if the block number is out of
+/// the supported range.
+inline int get_seal_epoch_number(const header_seal& seal) noexcept
+{
+    if (seal.block_number < 0)
+        return -1;
+    const int epoch_number = get_epoch_number(seal.block_number);
+    return epoch_number <= max_epoch_number ? epoch_number : -1;
+}
+
+/// Verifies the Ethash hash against the difficulty.
+struct difficulty_criterion
+{
+    const hash256& header_hash;
+    const hash256& mix_hash;
+    uint64_t nonce;
+    const hash256& difficulty;
+
+    ethash_errc verify_final_hash() const noexcept
+    {
+        return ethash_verify_final_hash_against_difficulty(
+            &header_hash, &mix_hash, nonce, &difficulty);
+    }
+
+    ethash_errc verify(const epoch_context_full& context) const noexcept
+    {
+        return ethash_verify_against_difficulty_full(
+            &context, &header_hash, &mix_hash, nonce, &difficulty);
+    }
+
+    ethash_errc verify(const epoch_context& context) const noexcept
+    {
+        return ethash_verify_against_difficulty(
+            &context, &header_hash, &mix_hash, nonce, &difficulty);
+    }
+};
+
+/// Verifies the Ethash hash against the boundary.
+struct boundary_criterion
+{
+    const hash256& header_hash;
+    const hash256& mix_hash;
+    uint64_t nonce;
+    const hash256& boundary;
+
+    ethash_errc verify_final_hash() const noexcept
+    {
+        const ethash_target target{boundary, be::uint64(boundary.word64s[0])};
+        return ethash_verify_final_hash_against_target(&header_hash, &mix_hash, nonce, &target);
+    }
+
+    ethash_errc verify(const epoch_context_full& context) const noexcept
+    {
+        return ethash_verify_against_boundary_full(
+            &context, &header_hash, &mix_hash, nonce, &boundary);
+    }
+
+    ethash_errc verify(const epoch_context& context) const noexcept
+    {
+        return ethash_verify_against_boundary(&context, &header_hash, &mix_hash, nonce, &boundary);
+    }
+};
+
+/// Verifies the Ethash hash against the prepared target.
+struct target_criterion
+{
+    const hash256& header_hash;
+    const hash256& mix_hash;
+    uint64_t nonce;
+    const ethash_target& target;
+
+    ethash_errc verify_final_hash() const noexcept
+    {
+        return ethash_verify_final_hash_against_target(&header_hash, &mix_hash, nonce, &target);
+    }
+
+    ethash_errc verify(const epoch_context_full& context) const noexcept
+    {
+        return ethash_verify_against_target_full(&context, &header_hash, &mix_hash, nonce, &target);
+    }
+
+    ethash_errc verify(const epoch_context& context) const noexcept
+    {
+        return ethash_verify_against_target(&context, &header_hash, &mix_hash, nonce, &target);
+    }
+};
+
+/// Verifies the Ethash hash with the epoch contexts of the source.
+///
+/// The epoch number is validated first. The full context is used if the source already has it.
+/// Otherwise, the final hash is checked before the light context is requested, so invalid seals
+/// do not trigger building it.
+///
+/// The source provides find_full(epoch_number) returning the (scoped) pointer to the full context
+/// or null, without building it, and get_light(epoch_number) returning the (smart) pointer to
+/// the light context, null in case of memory allocation failure.
+///
+/// @return  Error code: ::ETHASH_INVALID_EPOCH_NUMBER if the epoch number is out of the supported
+///          range, ::ETHASH_OUT_OF_MEMORY if the light context cannot be created,
+///          otherwise the result of the criterion.
+template <typename Source, typename Criterion>
+ethash_errc verify_with_source(
+    const Source& source, int epoch_number, const Criterion& criterion) noexcept
+{
+    if (epoch_number < 0 || epoch_number > max_epoch_number)
+        return ETHASH_INVALID_EPOCH_NUMBER;
+
+    {
+        const auto context_full = source.find_full(epoch_number);
+        if (context_full)
+            return criterion.verify(*context_full);
+    }
+
+    const auto ec = criterion.verify_final_hash();
+    if (ec != ETHASH_SUCCESS)
+        return ec;
+
+    const auto context = source.get_light(epoch_number);
+    if (!context)
+        return ETHASH_OUT_OF_MEMORY;
+
+    return criterion.verify(*context);
+}
+}  // namespace ethash
@@ -367,6 +367,62 @@ union ethash_hash256 ethash_keccak256_32(const uint8_t data[32])
     return hash;
 }
 
+union ethash_hash256 ethash_keccak256_ranges(
+    const struct ethash_bytes_range* ranges, size_t num_ranges)
+{
+    static const size_t word_size = sizeof(uint64_t);
+    static const size_t block_size = (1600 - 256 * 2) / 8;
+
+    size_t i;
+    size_t pos = 0;  // The number of bytes absorbed into the current block.
+    union ethash_hash256 hash;
+    uint64_t state[25] = {0};
+
+    for (i = 0; i < num_ranges; ++i)
+    {
+        const uint8_t* data = ranges[i].data;
+        size_t size = ranges[i].size;
+
+        while (size > 0)
+        {
+            if (size >= word_size && block_size - pos >= word_size)
+            {
+                // The word may be split between two state words if the ranges are not aligned.
+                const uint64_t word = load_le(data);
+                const unsigned shift = (unsigned)(8 * (pos % word_size));
+                state[pos / word_size] ^= word << shift;
+                if (shift != 0)
+                    state[pos / word_size + 1] ^= word >> (64 - shift);
+                data += word_size;
+                size -= word_size;
+                pos += word_size;
+            }
+            else
+            {
+                state[pos / word_size] ^= (uint64_t)*data << (8 * (pos % word_size));
+                ++data;
+                --size;
+                ++pos;
+            }
+
+            if (pos == block_size)
+            {
+                keccakf1600_best(state);
+                pos = 0;
+            }
+        }
+    }
+
+    state[pos / word_size] ^= (uint64_t)0x01 << (8 * (pos % word_size));
+    state[(block_size / word_size) - 1] ^= 0x8000000000000000;
+
+    keccakf1600_best(state);
+
+    for (i = 0; i < (sizeof(hash) / word_size); ++i)
+        hash.word64s[i] = to_le64(state[i]);
+    return hash;
+}
+
 union ethash_hash512 ethash_keccak512(const uint8_t* data, size_t size)
 {
     union ethash_hash512 hash;
@@ -38,6 +38,21 @@ BENCHMARK(calculate_full_dataset_num_items)
     ->Arg(ethash::max_epoch_number - 1)
     ->Arg(ethash::max_epoch_number);
 
+static void find_largest_prime(benchmark::State& state)
+{
+    const auto upper_bound = static_cast<int>(state.range(0));
+
+    for (auto _ : state)
+    {
+        auto prime = ethash_find_largest_prime(upper_bound);
+        benchmark::DoNotOptimize(&prime);
+    }
+}
+BENCHMARK(find_largest_prime)
+    ->Arg(ethash::light_cache_num_items_upper_bound(ethash::max_epoch_number))
+    ->Arg(ethash::full_dataset_num_items_upper_bound(ethash::max_epoch_number - 1))
+    ->Arg(ethash::full_dataset_num_items_upper_bound(ethash::max_epoch_number));
+
 
 static void seed(benchmark::State& state)
 {
@@ -51,6 +66,18 @@ static void seed(benchmark::State& state)
 }
 BENCHMARK(seed)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
 
+static void find_epoch_number(benchmark::State& state)
+{
+    const auto seed = ethash::calculate_epoch_seed(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        auto epoch_number = ethash::find_epoch_number(seed);
+        benchmark::DoNotOptimize(&epoch_number);
+    }
+}
+BENCHMARK(find_epoch_number)->Arg(1)->Arg(10000)->Arg(ethash::max_epoch_number);
+
 
 static void create_context(benchmark::State& state)
 {
@@ -91,6 +118,79 @@ static void ethash_hash(benchmark::State& state)
 BENCHMARK(ethash_hash)->Unit(benchmark::kMicrosecond)->Arg(0)->Arg(10);
 
 
+/// Makes the difficulty value having the given number of significant bits.
+static ethash::hash256 make_difficulty(int num_bits) noexcept
+{
+    auto difficulty = ethash::keccak256(nullptr, 0);
+    const int num_zero_bits = 256 - num_bits;
+    for (int i = 0; i < num_zero_bits / 8; ++i)
+        difficulty.bytes[i] = 0;
+    if (num_zero_bits % 8 != 0)
+        difficulty.bytes[num_zero_bits / 8] &= 0xff >> (num_zero_bits % 8);
+    difficulty.bytes[num_zero_bits / 8] |= 0x80 >> (num_zero_bits % 8);
+    return difficulty;
+}
+
+static void difficulty_to_boundary(benchmark::State& state)
+{
+    const auto difficulty = make_difficulty(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(difficulty.bytes);
+        auto boundary = ethash::difficulty_to_boundary(difficulty);
+        benchmark::DoNotOptimize(boundary.bytes);
+    }
+}
+BENCHMARK(difficulty_to_boundary)->Arg(53)->Arg(64)->Arg(128)->Arg(256);
+
+static void check_against_difficulty(benchmark::State& state)
+{
+    const auto difficulty = make_difficulty(static_cast<int>(state.range(0)));
+    const auto hash = ethash::keccak256(difficulty);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(difficulty.bytes);
+        auto valid = ethash::check_against_difficulty(hash, difficulty);
+        benchmark::DoNotOptimize(valid);
+    }
+}
+BENCHMARK(check_against_difficulty)->Arg(53)->Arg(64)->Arg(128)->Arg(256);
+
+static void check_target(benchmark::State& state)
+{
+    const auto target = ethash::prepare_target(make_difficulty(static_cast<int>(state.range(0))));
+    const auto hash = ethash::keccak256(target.boundary);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hash.bytes);
+        auto valid = ethash::check_target(target, hash);
+        benchmark::DoNotOptimize(valid);
+    }
+}
+BENCHMARK(check_target)->Arg(53)->Arg(64)->Arg(128)->Arg(256);
+
+
+static void decode_header_seal(benchmark::State& state)
+{
+    const auto difficulty =
+        to_hash256("00000000000000000000000000000000000000000000000000000bb8be7e7cbf");
+    const auto header = rlp_encode_list(make_header_fields(5000000, difficulty, {}, 1));
+
+    for (auto _ : state)
+    {
+        ethash::header_seal seal;
+        benchmark::DoNotOptimize(header.data());
+        ethash::decode_header_seal(
+            seal, reinterpret_cast<const uint8_t*>(header.data()), header.size());
+        benchmark::DoNotOptimize(seal.header_hash.bytes);
+    }
+}
+BENCHMARK(decode_header_seal);
+
+
 static void verify(benchmark::State& state)
 {
     const int block_number = 5000000;
@@ -110,6 +210,48 @@ static void verify(benchmark::State& state)
 BENCHMARK(verify);
 
 
+static void verify_item_cache(benchmark::State& state)
+{
+    const int block_number = 5000000;
+    const ethash::hash256 header_hash =
+        to_hash256("bc544c2baba832600013bd5d1983f592e9557d04b0fb5ef7a100434a5fc8d52a");
+    const ethash::hash256 mix_hash =
+        to_hash256("94cd4e844619ee20989578276a0a9046877d569d37ba076bf2e8e34f76189dea");
+    const uint64_t nonce = 0x4617a20003ba3f25;
+    const ethash::hash256 boundary =
+        to_hash256("0000000000001a5c000000000000000000000000000000000000000000000000");
+
+    static const auto ctx = ethash::create_epoch_context(ethash::get_epoch_number(block_number));
+    static const bool cache_attached = ethash::attach_item_cache(*ctx, 64 * 1024 * 1024);
+    benchmark::DoNotOptimize(cache_attached);
+
+    for (auto _ : state)
+        ethash::verify_against_boundary(*ctx, header_hash, mix_hash, nonce, boundary);
+}
+BENCHMARK(verify_item_cache);
+
+
+static void verify_seal_cache(benchmark::State& state)
+{
+    const int block_number = 5000000;
+    const ethash::hash256 header_hash =
+        to_hash256("bc544c2baba832600013bd5d1983f592e9557d04b0fb5ef7a100434a5fc8d52a");
+    const ethash::hash256 mix_hash =
+        to_hash256("94cd4e844619ee20989578276a0a9046877d569d37ba076bf2e8e34f76189dea");
+    const uint64_t nonce = 0x4617a20003ba3f25;
+    const ethash::hash256 boundary =
+        to_hash256("0000000000001a5c000000000000000000000000000000000000000000000000");
+
+    static const auto ctx = ethash::create_epoch_context(ethash::get_epoch_number(block_number));
+    static const bool cache_attached = ethash::attach_seal_cache(*ctx, 1024 * 1024);
+    benchmark::DoNotOptimize(cache_attached);
+
+    for (auto _ : state)
+        ethash::verify_against_boundary(*ctx, header_hash, mix_hash, nonce, boundary);
+}
+BENCHMARK(verify_seal_cache);
+
+
 static void verify_mt(benchmark::State& state)
 {
     const int block_number = 5000000;
@@ -19,3 +19,36 @@ static void get_epoch_context(benchmark::State& state)
     }
 }
 BENCHMARK(get_epoch_context)->Arg(0)->ThreadRange(1, 8);
+
+static void get_epoch_context_alternating(benchmark::State& state)
+{
+    // Every call misses the thread-local context and looks up the shared contexts.
+    ethash::get_global_epoch_context(0);
+    ethash::get_global_epoch_context(1);
+
+    int e = 0;
+    for (auto _ : state)
+    {
+        auto& ctx = ethash::get_global_epoch_context(e);
+        benchmark::DoNotOptimize(&ctx);
+        e ^= 1;
+    }
+}
+BENCHMARK(get_epoch_context_alternating)->ThreadRange(1, 8);
+
+static void get_epoch_context_switch(benchmark::State& state)
+{
+    // The epoch switches every given number of calls, like during the sync.
+    const auto period = static_cast<int>(state.range(0));
+
+    ethash::get_global_epoch_context(0);
+    ethash::get_global_epoch_context(1);
+
+    int i = 0;
+    for (auto _ : state)
+    {
+        auto& ctx = ethash::get_global_epoch_context((i++ / period) % 2);
+        benchmark::DoNotOptimize(&ctx);
+    }
+}
+BENCHMARK(get_epoch_context_switch)->Arg(16)->Arg(256)->ThreadRange(1, 8);
@@ -52,10 +52,16 @@ class ethash_full : public ethash_interface
 {
     const ethash::epoch_context_full& context;
 
+    static const ethash::epoch_context_full& get_context(int epoch_number)
+    {
+        const auto* context = ethash::get_global_epoch_context_full(epoch_number);
+        if (context == nullptr)
+            throw std::bad_alloc{};
+        return *context;
+    }
+
 public:
-    explicit ethash_full(int epoch_number)
-      : context(ethash::get_global_epoch_context_full(epoch_number))
-    {}
+    explicit ethash_full(int epoch_number) : context(get_context(epoch_number)) {}
 
     void search(const ethash::hash256& header_hash, uint64_t nonce,
         size_t iterations) const noexcept override
@@ -84,9 +90,17 @@ void worker(bool light, const ethash::hash256& header_hash, uint64_t start_nonce
 
         if (current_epoch != e)
         {
-            ei.reset(
-                light ? static_cast<ethash_interface*>(new ethash_light{e}) : new ethash_full{e});
-            current_epoch = e;
+            // In full mode, keep mining the previous epoch until the full context prepared
+            // in the background is ready. Build it on demand if it has not been requested.
+            const bool ready = light || ei == nullptr ||
+                               ethash::try_get_global_epoch_context_full(e) != nullptr ||
+                               !ethash::prepare_global_epoch_context_full(e);
+            if (ready)
+            {
+                ei.reset(light ? static_cast<ethash_interface*>(new ethash_light{e}) :
+                                 new ethash_full{e});
+                current_epoch = e;
+            }
         }
 
         ei->search(header_hash, start_nonce + i, w);
@@ -104,6 +118,7 @@ int main(int argc, const char* argv[])
     int work_size = 100;
     int num_threads = static_cast<int>(std::thread::hardware_concurrency());
     uint64_t start_nonce = 0;
+    int prepare_distance = 5;
     bool light = false;
 
     for (int i = 0; i < argc; ++i)
@@ -120,6 +135,8 @@ int main(int argc, const char* argv[])
             num_threads = std::stoi(argv[++i]);
         else if (arg == "-n" && i + 1 < argc)
             start_nonce = std::stoul(argv[++i]);
+        else if (arg == "-p" && i + 1 < argc)
+            prepare_distance = std::stoi(argv[++i]);
     }
 
     auto flags = std::cout.flags();
@@ -133,6 +150,7 @@ int main(int argc, const char* argv[])
               << "\n  block time:  " << block_time
               << "\n  batch size:  " << work_size
               << "\n  start nonce: " << start_nonce
+              << "\n  prepare:     " << prepare_distance << " blocks before epoch"
               << "\n\n";
     // clang-format on
 
@@ -184,6 +202,12 @@ int main(int argc, const char* argv[])
 
         shared_block_number.store(block_number + 1, std::memory_order_relaxed);
 
+        // Prepare the full dataset of the next epoch in the background.
+        const int next_epoch_number = ethash::get_epoch_number(block_number + 1) + 1;
+        if (!light && prepare_distance > 0 &&
+            next_epoch_number * ethash::epoch_length - (block_number + 1) <= prepare_distance)
+            ethash::prepare_global_epoch_context_full(next_epoch_number);
+
         int e = ethash::get_epoch_number(block_number);
 
         current_khps = double(current_hashes) / current_duration;
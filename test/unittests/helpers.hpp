@@ -7,6 +7,7 @@
 #include "../../lib/ethash/endianness.hpp"
 #include <ethash/ethash.hpp>
 #include <string>
+#include <vector>
 
 template <typename Hash>
 inline std::string to_hex(const Hash& h)
@@ -82,3 +83,76 @@ inline const ethash::epoch_context& get_ethash_epoch_context_0() noexcept
     static ethash::epoch_context_ptr context = ethash::create_epoch_context(0);
     return *context;
 }
+
+/// Encodes the byte string in RLP.
+inline std::string rlp_encode(const std::string& bytes)
+{
+    if (bytes.size() == 1 && uint8_t(bytes[0]) < 0x80)
+        return bytes;
+
+    std::string length;
+    for (auto s = bytes.size(); s != 0; s >>= 8)
+        length.insert(length.begin(), char(s & 0xff));
+
+    if (bytes.size() < 56)
+        return char(0x80 + bytes.size()) + bytes;
+    return char(0xb7 + length.size()) + length + bytes;
+}
+
+/// Encodes the list of RLP-encoded items in RLP.
+inline std::string rlp_encode_list(const std::vector<std::string>& items)
+{
+    std::string payload;
+    for (const auto& item : items)
+        payload += item;
+
+    std::string length;
+    for (auto s = payload.size(); s != 0; s >>= 8)
+        length.insert(length.begin(), char(s & 0xff));
+
+    if (payload.size() < 56)
+        return char(0xc0 + payload.size()) + payload;
+    return char(0xf7 + length.size()) + length + payload;
+}
+
+/// Encodes the big-endian number, given as bytes, in RLP. The leading zeros are skipped.
+inline std::string rlp_encode_uint(const uint8_t* bytes, size_t size)
+{
+    while (size > 0 && bytes[0] == 0)
+    {
+        ++bytes;
+        --size;
+    }
+    return rlp_encode(std::string(reinterpret_cast<const char*>(bytes), size));
+}
+
+inline std::string rlp_encode_uint(uint64_t x)
+{
+    const auto be_x = ethash::be::uint64(x);
+    return rlp_encode_uint(reinterpret_cast<const uint8_t*>(&be_x), sizeof(be_x));
+}
+
+/// Creates the RLP-encoded fields of the proof-of-work block header.
+/// The fields not used by Ethash are filled with the arbitrary data.
+inline std::vector<std::string> make_header_fields(int block_number,
+    const ethash::hash256& difficulty, const ethash::hash256& mix_hash, uint64_t nonce)
+{
+    const auto be_nonce = ethash::be::uint64(nonce);
+    return {
+        rlp_encode(std::string(32, '\x01')),   // Parent hash.
+        rlp_encode(std::string(32, '\x02')),   // Ommers hash.
+        rlp_encode(std::string(20, '\x03')),   // Beneficiary.
+        rlp_encode(std::string(32, '\x04')),   // State root.
+        rlp_encode(std::string(32, '\x05')),   // Transactions root.
+        rlp_encode(std::string(32, '\x06')),   // Receipts root.
+        rlp_encode(std::string(256, '\x07')),  // Logs bloom.
+        rlp_encode_uint(difficulty.bytes, sizeof(difficulty)),
+        rlp_encode_uint(uint64_t(block_number)),
+        rlp_encode_uint(8000000),     // Gas limit.
+        rlp_encode_uint(21000),       // Gas used.
+        rlp_encode_uint(1500000000),  // Timestamp.
+        rlp_encode("ethash"),         // Extra data.
+        rlp_encode(std::string(reinterpret_cast<const char*>(mix_hash.bytes), sizeof(mix_hash))),
+        rlp_encode(std::string(reinterpret_cast<const char*>(&be_nonce), sizeof(be_nonce))),
+    };
+}
@@ -2,10 +2,11 @@
 // Copyright 2021 Pawel Bylica.
 // Licensed under the Apache License, Version 2.0.
 
-#include "../experimental/difficulty.h"
 #include "helpers.hpp"
 #include <ethash/ethash-internal.hpp>
+#include <ethash/keccak.hpp>
 #include <gtest/gtest.h>
+#include <cstring>
 
 using namespace ethash;
 
@@ -87,6 +88,28 @@ TEST(difficulty, difficulty_to_boundary)
     }
 }
 
+TEST(difficulty, difficulty_to_boundary_random)
+{
+    // The boundary is the largest hash satisfying the difficulty.
+    hash256 x{};
+    for (int i = 0; i < 10000; ++i)
+    {
+        x = keccak256(x);
+        hash256 difficulty = x;
+        std::memset(difficulty.bytes, 0, static_cast<size_t>(i % 32));
+
+        const auto boundary = difficulty_to_boundary(difficulty);
+        EXPECT_TRUE(check_against_difficulty(boundary, difficulty)) << to_hex(difficulty);
+
+        const auto boundary_inc = inc(boundary);
+        if (less_equal(boundary, boundary_inc))
+        {
+            EXPECT_FALSE(check_against_difficulty(boundary_inc, difficulty))
+                << to_hex(difficulty);
+        }
+    }
+}
+
 TEST(difficulty, check_against_difficulty)
 {
     for (const auto& t : difficulty_test_cases)
@@ -138,3 +161,29 @@ TEST(difficulty, check_against_difficulty_interesting_hashes)
         }
     }
 }
+
+TEST(difficulty, check_target)
+{
+    for (const auto& t : difficulty_test_cases)
+    {
+        const auto difficulty = to_hash256(t.difficulty_hex);
+        const auto boundary = to_hash256(t.boundary_hex);
+        const auto target = prepare_target(difficulty);
+        EXPECT_EQ(target.boundary, boundary);
+
+        // The hashes around the boundary share the top word with it and exercise
+        // the full comparison.
+        EXPECT_TRUE(check_target(target, boundary));
+        EXPECT_TRUE(check_target(target, dec(boundary)));
+        if (!equal(inc(boundary), hash256{}))
+        {
+            EXPECT_FALSE(check_target(target, inc(boundary)));
+        }
+
+        for (const auto& hash_hex : interesting_hashes)
+        {
+            const auto hash = to_hash256(hash_hex);
+            EXPECT_EQ(check_target(target, hash), check_against_difficulty(hash, difficulty));
+        }
+    }
+}
@@ -9,9 +9,11 @@
 #include <ethash/endianness.hpp>
 #include <ethash/ethash-internal.hpp>
 #include <ethash/ethash.hpp>
+#include <ethash/hash_kernel.hpp>
 #include <ethash/keccak.hpp>
+#include <ethash/primes.h>
+#include <ethash/profiling.h>
 
-#include "../experimental/difficulty.h"
 #include "helpers.hpp"
 #include "test_cases.hpp"
 
@@ -24,11 +26,6 @@ using namespace ethash;
 
 namespace
 {
-struct test_context_full : epoch_context
-{
-    hash1024* full_dataset;
-};
-
 /// Creates the epoch context of the correct size but filled with fake data.
 epoch_context_ptr create_epoch_context_mock(int epoch_number)
 {
@@ -93,12 +90,36 @@ TEST(ethash, error_code)
     os << ec;
     EXPECT_EQ(os.str(), "ethash:2");
 
-    ec = static_cast<ethash_errc>(3);
+    ec = ETHASH_INVALID_HEADER;
     EXPECT_TRUE(ec);
-    EXPECT_EQ(ec.message(), "unknown error");
+    EXPECT_EQ(ec.message(), "invalid header");
     os.str({});
     os << ec;
     EXPECT_EQ(os.str(), "ethash:3");
+
+    ec = ETHASH_INVALID_EPOCH_NUMBER;
+    EXPECT_TRUE(ec);
+    EXPECT_EQ(ec.message(), "invalid epoch number");
+    EXPECT_EQ(ec, std::errc::invalid_argument);
+    os.str({});
+    os << ec;
+    EXPECT_EQ(os.str(), "ethash:4");
+
+    ec = ETHASH_OUT_OF_MEMORY;
+    EXPECT_TRUE(ec);
+    EXPECT_EQ(ec.message(), "out of memory");
+    EXPECT_EQ(ec, std::errc::not_enough_memory);
+    EXPECT_NE(ec, std::errc::invalid_argument);
+    os.str({});
+    os << ec;
+    EXPECT_EQ(os.str(), "ethash:5");
+
+    ec = {6, ethash_category()};
+    EXPECT_TRUE(ec);
+    EXPECT_EQ(ec.message(), "unknown error");
+    os.str({});
+    os << ec;
+    EXPECT_EQ(os.str(), "ethash:6");
 }
 
 TEST(hash, hash256_from_bytes)
@@ -216,6 +237,19 @@ TEST(ethash, full_dataset_size)
     }
 }
 
+TEST(ethash, num_items_all_epochs)
+{
+    for (int epoch_number = 0; epoch_number <= max_epoch_number; ++epoch_number)
+    {
+        ASSERT_EQ(calculate_light_cache_num_items(epoch_number),
+            ethash_find_largest_prime(light_cache_num_items_upper_bound(epoch_number)))
+            << "epoch: " << epoch_number;
+        ASSERT_EQ(calculate_full_dataset_num_items(epoch_number),
+            ethash_find_largest_prime(full_dataset_num_items_upper_bound(epoch_number)))
+            << "epoch: " << epoch_number;
+    }
+}
+
 
 struct epoch_seed_test_case
 {
@@ -243,6 +277,18 @@ TEST(ethash, calculate_epoch_seed)
     }
 }
 
+TEST(ethash, calculate_epoch_seed_all_epochs)
+{
+    EXPECT_EQ(calculate_epoch_seed(-1), hash256{});
+
+    hash256 seed = {};
+    for (int i = 0; i <= max_epoch_number + 1; ++i)
+    {
+        ASSERT_EQ(calculate_epoch_seed(i), seed) << "epoch: " << i;
+        seed = keccak256(seed);
+    }
+}
+
 
 TEST(ethash, find_epoch_number_double_ascending)
 {
@@ -400,6 +446,21 @@ TEST(ethash, create_context_invalid_epoch)
     EXPECT_EQ(create_epoch_context(max_epoch_number + 1), nullptr);
 }
 
+TEST(ethash, create_context_full_from_light)
+{
+    const auto light = create_epoch_context(0);
+    const auto full = create_epoch_context_full(*light);
+    ASSERT_NE(full, nullptr);
+
+    const epoch_context& light_of_full = *full;
+    EXPECT_EQ(light_of_full.epoch_number, 0);
+    EXPECT_EQ(light_of_full.full_dataset_num_items, light->full_dataset_num_items);
+    ASSERT_EQ(light_of_full.light_cache_num_items, light->light_cache_num_items);
+    EXPECT_NE(light_of_full.light_cache, light->light_cache);
+    EXPECT_EQ(to_hex(light_of_full.light_cache[0]), to_hex(light->light_cache[0]));
+    EXPECT_EQ(hash(*full, {}, 0).final_hash, hash(*light, {}, 0).final_hash);
+}
+
 TEST(ethash, fake_dataset_partial_items)
 {
     struct full_dataset_item_test_case
@@ -631,6 +692,17 @@ TEST(ethash, verify_hash_light)
         ec = verify_against_difficulty(*context, header_hash, mix_hash, nonce, one);
         EXPECT_EQ(ec, ETHASH_SUCCESS);
 
+        const auto target = prepare_target(difficulty);
+        ec = verify_against_target(*context, header_hash, mix_hash, nonce, target);
+        EXPECT_EQ(ec, ETHASH_SUCCESS);
+
+        ec = verify_final_hash_against_target(header_hash, mix_hash, nonce, target);
+        EXPECT_EQ(ec, ETHASH_SUCCESS);
+
+        ec = verify_against_target(
+            *context, header_hash, mix_hash, nonce, prepare_target(inc(difficulty)));
+        EXPECT_EQ(ec, ETHASH_INVALID_FINAL_HASH);
+
         const bool within_significant_boundary = r.final_hash.bytes[0] == 0;
         if (within_significant_boundary)
         {
@@ -687,6 +759,278 @@ TEST(ethash, verify_hash)
     }
 }
 
+namespace
+{
+/// Hashes the header fields without the mix hash and nonce, i.e. the reference header hash.
+hash256 hash_header_fields(std::vector<std::string> fields)
+{
+    fields.erase(fields.begin() + 13, fields.begin() + 15);
+    const auto rlp = rlp_encode_list(fields);
+    return keccak256(reinterpret_cast<const uint8_t*>(rlp.data()), rlp.size());
+}
+
+std::error_code decode(header_seal& seal, const std::string& header)
+{
+    return decode_header_seal(seal, reinterpret_cast<const uint8_t*>(header.data()), header.size());
+}
+}  // namespace
+
+TEST(ethash, decode_header_seal)
+{
+    const int block_number = 5000000;
+    const auto difficulty =
+        to_hash256("00000000000000000000000000000000000000000000000000000bb8be7e7cbf");
+    const auto mix_hash =
+        to_hash256("94cd4e844619ee20989578276a0a9046877d569d37ba076bf2e8e34f76189dea");
+    const uint64_t nonce = 0x4617a20003ba3f25;
+
+    auto fields = make_header_fields(block_number, difficulty, mix_hash, nonce);
+
+    header_seal seal{};
+    EXPECT_FALSE(decode(seal, rlp_encode_list(fields)));
+    EXPECT_EQ(seal.header_hash, hash_header_fields(fields));
+    EXPECT_EQ(seal.mix_hash, mix_hash);
+    EXPECT_EQ(seal.difficulty, difficulty);
+    EXPECT_EQ(seal.nonce, nonce);
+    EXPECT_EQ(seal.block_number, block_number);
+
+    // The fields following the seal (e.g. the base fee) are hashed.
+    fields.push_back(rlp_encode_uint(7));
+    seal = {};
+    EXPECT_FALSE(decode(seal, rlp_encode_list(fields)));
+    EXPECT_EQ(seal.header_hash, hash_header_fields(fields));
+    EXPECT_EQ(seal.nonce, nonce);
+    fields.pop_back();
+
+    // The extra data making the list length prefix shorter when the seal is excluded.
+    int num_long_headers = 0;
+    for (size_t extra_size = 65000; extra_size < 66000; ++extra_size)
+    {
+        fields[12] = rlp_encode(std::string(extra_size, 'x'));
+        const auto header = rlp_encode_list(fields);
+        if (header.size() != 65536 + 4 + 10)
+            continue;
+        EXPECT_EQ(uint8_t(header[0]), 0xf7 + 3);
+        EXPECT_FALSE(decode(seal, header));
+        EXPECT_EQ(seal.header_hash, hash_header_fields(fields));
+        ++num_long_headers;
+    }
+    EXPECT_EQ(num_long_headers, 1);
+
+    // The smallest values.
+    fields = make_header_fields(0, hash256{}, hash256{}, 0);
+    EXPECT_FALSE(decode(seal, rlp_encode_list(fields)));
+    EXPECT_EQ(seal.header_hash, hash_header_fields(fields));
+    EXPECT_EQ(seal.difficulty, hash256{});
+    EXPECT_EQ(seal.nonce, 0);
+    EXPECT_EQ(seal.block_number, 0);
+}
+
+TEST(ethash, decode_header_seal_invalid)
+{
+    const auto difficulty =
+        to_hash256("0000000000000000000000000000000000000000000000000000000000000100");
+    const auto fields = make_header_fields(1, difficulty, hash256{}, 1);
+    const auto header = rlp_encode_list(fields);
+
+    header_seal seal{};
+    ASSERT_FALSE(decode(seal, header));
+
+    const auto invalid = [&](const std::string& h) {
+        return decode(seal, h) == ETHASH_INVALID_HEADER;
+    };
+
+    EXPECT_TRUE(invalid(""));
+    EXPECT_TRUE(invalid(header.substr(0, header.size() - 1)));
+    EXPECT_TRUE(invalid(header + '\0'));
+    EXPECT_TRUE(invalid(fields[0]));
+
+    // Non-canonical list length.
+    auto long_length = header;
+    long_length.replace(0, 3, std::string{"\xfb\x00\x00", 3} + header.substr(1, 2));
+    EXPECT_TRUE(invalid(long_length));
+
+    auto f = fields;
+    f.pop_back();
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+
+    f = fields;
+    f[13] = rlp_encode(std::string(31, 'm'));
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+
+    f = fields;
+    f[13] = rlp_encode_list({rlp_encode(std::string(30, 'm'))});
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+
+    f = fields;
+    f[14] = rlp_encode(std::string(9, 'n'));
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+
+    // Difficulty with leading zero, too long or encoded as non-canonical single byte.
+    f = fields;
+    f[7] = rlp_encode(std::string{"\x00\x01", 2});
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+    f[7] = rlp_encode(std::string(33, '\x01'));
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+    f[7] = std::string{"\x81\x01"};
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+
+    // Block number beyond the supported epochs.
+    f = fields;
+    f[8] = rlp_encode_uint(uint64_t{max_epoch_number + 1} * epoch_length - 1);
+    EXPECT_FALSE(decode(seal, rlp_encode_list(f)));
+    f[8] = rlp_encode_uint(uint64_t{max_epoch_number + 1} * epoch_length);
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+    f[8] = rlp_encode_uint(~uint64_t{0});
+    EXPECT_TRUE(invalid(rlp_encode_list(f)));
+}
+
+TEST(ethash, verify_hash_light_item_cache)
+{
+    const auto context = create_epoch_context(0);
+    EXPECT_EQ(get_item_cache_stats(*context).capacity, 0);
+    EXPECT_FALSE(attach_item_cache(*context, 100));
+    ASSERT_TRUE(attach_item_cache(*context, 1024 * 1024));
+    EXPECT_FALSE(attach_item_cache(*context, 1024 * 1024));
+    EXPECT_GT(get_item_cache_stats(*context).capacity, 7000);
+
+    const hash256 header_hash =
+        to_hash256("e74e5e8688d3c6f17885fa5e64eb6718046b57895a2a24c593593070ab71f5fd");
+    const uint64_t nonce = 6666;
+    const auto boundary =
+        to_hash256("13c5a668bba6b86ed16098113d9d6a7a5cac1802e9c8f2d57c932d8818375eb7");
+
+    const auto r = hash(*context, header_hash, nonce);
+    EXPECT_EQ(r.final_hash, boundary);
+    auto stats = get_item_cache_stats(*context);
+    EXPECT_EQ(stats.hits + stats.misses, num_dataset_accesses);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(verify_against_boundary(*context, header_hash, r.mix_hash, nonce, boundary),
+            ETHASH_SUCCESS);
+        EXPECT_EQ(verify_against_boundary(*context, header_hash, r.mix_hash, nonce + 1, dec({})),
+            ETHASH_INVALID_MIX_HASH);
+    }
+    stats = get_item_cache_stats(*context);
+    EXPECT_EQ(stats.hits + stats.misses, 7 * num_dataset_accesses);
+    EXPECT_GE(stats.hits, 3 * num_dataset_accesses);
+
+    // Compare with the results computed without the cache.
+    const auto& context_nocache = get_ethash_epoch_context_0();
+    for (uint64_t n = 0; n < 100; ++n)
+    {
+        EXPECT_EQ(hash(*context, header_hash, n).mix_hash,
+            hash(context_nocache, header_hash, n).mix_hash);
+    }
+}
+
+TEST(ethash, caches_of_user_contexts)
+{
+    // The contexts not created by the library can also have the caches attached.
+    auto context = create_epoch_context_mock(0);
+    const epoch_context copy{context->epoch_number, context->light_cache_num_items,
+        context->light_cache, context->full_dataset_num_items};
+    EXPECT_EQ(get_item_cache_stats(copy).capacity, 0);
+    EXPECT_EQ(get_seal_cache_stats(copy).capacity, 0);
+
+    ASSERT_TRUE(attach_item_cache(*context, 1024 * 1024));
+    ASSERT_TRUE(attach_seal_cache(*context, 4096));
+    EXPECT_GT(get_item_cache_stats(*context).capacity, 0);
+    EXPECT_GT(get_seal_cache_stats(*context).capacity, 0);
+    EXPECT_EQ(get_item_cache_stats(copy).capacity, 0);
+    EXPECT_EQ(get_seal_cache_stats(copy).capacity, 0);
+
+    const hash256 header_hash = {};
+    EXPECT_EQ(hash(*context, header_hash, 1).mix_hash, hash(copy, header_hash, 1).mix_hash);
+    EXPECT_EQ(get_item_cache_stats(*context).misses, num_dataset_accesses);
+
+    // The caches are destroyed together with the context.
+    const auto* const address = context.get();
+    context.reset();
+    EXPECT_EQ(ethash_get_item_cache_stats(address).capacity, 0);
+    EXPECT_EQ(ethash_get_seal_cache_stats(address).capacity, 0);
+}
+
+TEST(ethash, caches_of_reused_context_address)
+{
+    const auto context = create_epoch_context_mock(0);
+    void* const storage = std::malloc(sizeof(epoch_context));
+    ASSERT_NE(storage, nullptr);
+
+    const auto* const first = new (storage) epoch_context{0, context->light_cache_num_items,
+        context->light_cache, context->full_dataset_num_items};
+    ASSERT_TRUE(attach_item_cache(*first, 1024 * 1024));
+    ASSERT_TRUE(attach_seal_cache(*first, 4096));
+
+    // The first context is dropped without ethash_destroy_epoch_context(), the context
+    // of other epoch at the same address does not inherit its caches.
+    const auto* const second = new (storage) epoch_context{1, context->light_cache_num_items,
+        context->light_cache, context->full_dataset_num_items};
+    EXPECT_EQ(get_item_cache_stats(*second).capacity, 0);
+    EXPECT_EQ(get_seal_cache_stats(*second).capacity, 0);
+
+    // The stale record is reused.
+    ASSERT_TRUE(attach_item_cache(*second, 1024 * 1024));
+    EXPECT_GT(get_item_cache_stats(*second).capacity, 0);
+    EXPECT_EQ(get_seal_cache_stats(*second).capacity, 0);
+
+    ethash_destroy_epoch_context(const_cast<epoch_context*>(second));
+}
+
+TEST(ethash, verify_hash_light_seal_cache)
+{
+    const auto context = create_epoch_context(0);
+    EXPECT_EQ(get_seal_cache_stats(*context).capacity, 0);
+    EXPECT_FALSE(attach_seal_cache(*context, 100));
+    ASSERT_TRUE(attach_seal_cache(*context, 4096));
+    EXPECT_FALSE(attach_seal_cache(*context, 4096));
+    EXPECT_GT(get_seal_cache_stats(*context).capacity, 40);
+
+    const hash256 header_hash =
+        to_hash256("e74e5e8688d3c6f17885fa5e64eb6718046b57895a2a24c593593070ab71f5fd");
+    const uint64_t nonce = 6666;
+    const auto boundary =
+        to_hash256("13c5a668bba6b86ed16098113d9d6a7a5cac1802e9c8f2d57c932d8818375eb7");
+    const auto r = hash(*context, header_hash, nonce);
+    const auto invalid_mix_hash = inc(r.mix_hash);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(verify_against_boundary(*context, header_hash, r.mix_hash, nonce, boundary),
+            ETHASH_SUCCESS);
+        EXPECT_EQ(verify_against_boundary(*context, header_hash, invalid_mix_hash, nonce, dec({})),
+            ETHASH_INVALID_MIX_HASH);
+    }
+    auto stats = get_seal_cache_stats(*context);
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 4);
+
+    // The final hash is checked before the cache is consulted.
+    EXPECT_EQ(verify_against_boundary(*context, header_hash, r.mix_hash, nonce, dec(boundary)),
+        ETHASH_INVALID_FINAL_HASH);
+    const auto difficulty = ethash_difficulty_to_boundary(&boundary);
+    EXPECT_EQ(verify_against_difficulty(*context, header_hash, r.mix_hash, nonce, difficulty),
+        ETHASH_SUCCESS);
+    EXPECT_EQ(verify_against_target(
+                  *context, header_hash, r.mix_hash, nonce, prepare_target(difficulty)),
+        ETHASH_SUCCESS);
+    stats = get_seal_cache_stats(*context);
+    EXPECT_EQ(stats.hits, 4);
+    EXPECT_EQ(stats.misses, 4);
+
+    // Fill the cache over its capacity, the entries are evicted but the results stay correct.
+    for (uint64_t n = 0; n < 2 * stats.capacity; ++n)
+    {
+        const auto m = hash(get_ethash_epoch_context_0(), header_hash, n).mix_hash;
+        EXPECT_EQ(verify_against_boundary(*context, header_hash, m, n, dec({})), ETHASH_SUCCESS);
+        EXPECT_EQ(verify_against_boundary(*context, header_hash, m, n + 1, dec({})),
+            ETHASH_INVALID_MIX_HASH);
+    }
+    stats = get_seal_cache_stats(*context);
+    EXPECT_EQ(stats.hits, 4);
+}
+
 TEST(ethash, verify_final_hash_only)
 {
     auto& context = get_ethash_epoch_context_0();
@@ -744,8 +1088,9 @@ TEST(ethash_multithreaded, small_dataset)
     const_cast<int&>(context->full_dataset_num_items) = num_dataset_items;
 
     std::unique_ptr<hash1024[]> full_dataset{new hash1024[num_dataset_items]{}};
-    reinterpret_cast<test_context_full*>(context.get())->full_dataset = full_dataset.get();
-    auto context_full = reinterpret_cast<epoch_context_full*>(context.get());
+    const epoch_context_full full{context->epoch_number, context->light_cache_num_items,
+        context->light_cache, num_dataset_items, full_dataset.get()};
+    auto context_full = &full;
 
     std::array<std::future<search_result>, num_treads> futures;
     for (auto& f : futures)
@@ -768,8 +1113,9 @@ TEST(ethash, small_dataset)
     const_cast<int&>(context->full_dataset_num_items) = num_dataset_items;
 
     std::unique_ptr<hash1024[]> full_dataset{new hash1024[num_dataset_items]{}};
-    reinterpret_cast<test_context_full*>(context.get())->full_dataset = full_dataset.get();
-    auto context_full = reinterpret_cast<epoch_context_full*>(context.get());
+    const epoch_context_full full{context->epoch_number, context->light_cache_num_items,
+        context->light_cache, num_dataset_items, full_dataset.get()};
+    auto context_full = &full;
 
     auto solution = search_light(*context, {}, boundary, 940, 10);
     EXPECT_TRUE(solution.solution_found);
@@ -798,6 +1144,136 @@ TEST(ethash, small_dataset)
     EXPECT_EQ(solution.nonce, 0);
 }
 
+TEST(ethash, small_dataset_generated)
+{
+    constexpr int num_dataset_items = 501;
+    const hash256 boundary =
+        to_hash256("0080000000000000000000000000000000000000000000000000000000000000");
+
+    auto context = create_epoch_context_mock(0);
+    const_cast<int&>(context->full_dataset_num_items) = num_dataset_items;
+
+    std::unique_ptr<hash1024[]> full_dataset{new hash1024[num_dataset_items]{}};
+    const epoch_context_full full{context->epoch_number, context->light_cache_num_items,
+        context->light_cache, num_dataset_items, full_dataset.get()};
+    auto context_full = &full;
+
+    // The overlapping ranges count only the new items.
+    generate_full_dataset_items(*context_full, -10, 200);
+    generate_full_dataset_items(*context_full, 100, 200);
+    EXPECT_EQ(context_full->num_generated_items, 300);
+    EXPECT_FALSE(context_full->full_dataset_generated);
+
+    generate_full_dataset_items(*context_full, 190, 1000);
+    generate_full_dataset_items(*context_full, 0, num_dataset_items);
+    EXPECT_EQ(context_full->num_generated_items, num_dataset_items);
+    EXPECT_TRUE(context_full->full_dataset_generated);
+    for (int i = 0; i < num_dataset_items; ++i)
+    {
+        const auto item = calculate_dataset_item_1024(*context, static_cast<uint32_t>(i));
+        EXPECT_EQ(to_hex(full_dataset[static_cast<size_t>(i)]), to_hex(item)) << i;
+    }
+
+    const auto solution = search(*context_full, {}, boundary, 940, 10);
+    EXPECT_TRUE(solution.solution_found);
+    EXPECT_EQ(solution.nonce, 948);
+    EXPECT_EQ(to_hex(solution.final_hash),
+        "004b92ceeb2045f9745917e4d9868a0db16b06d60ee1d8d33b9ff859053f4bb8");
+    EXPECT_EQ(to_hex(solution.mix_hash),
+        "a5a4f053b8424f1c0a4403898d106f0488c8a819334c542ac4fabc0d2cbd7f26");
+}
+
+TEST(ethash, hash_custom_lookup)
+{
+    struct counting_lookup
+    {
+        int& num_lookups;
+
+        hash1024 operator()(const epoch_context& context, uint32_t index) const noexcept
+        {
+            ++num_lookups;
+            return calculate_dataset_item_1024(context, index);
+        }
+    };
+
+    const auto& context = get_ethash_epoch_context_0();
+    const hash256 header_hash =
+        to_hash256("e74e5e8688d3c6f17885fa5e64eb6718046b57895a2a24c593593070ab71f5fd");
+
+    int num_lookups = 0;
+    const auto r = hash(context, header_hash, 6666, counting_lookup{num_lookups});
+    EXPECT_EQ(num_lookups, num_dataset_accesses);
+    EXPECT_EQ(
+        to_hex(r.final_hash), "13c5a668bba6b86ed16098113d9d6a7a5cac1802e9c8f2d57c932d8818375eb7");
+
+    const auto expected = hash(context, header_hash, 6666);
+    EXPECT_EQ(r.mix_hash, expected.mix_hash);
+    EXPECT_EQ(hash(context, header_hash, 6666, light_lookup{}).mix_hash, expected.mix_hash);
+}
+
+TEST(ethash, profiling)
+{
+    const auto& context = get_ethash_epoch_context_0();
+    const hash256 header_hash =
+        to_hash256("e74e5e8688d3c6f17885fa5e64eb6718046b57895a2a24c593593070ab71f5fd");
+
+    ethash_profiling_reset();
+    hash(context, header_hash, 6666);
+    const auto snapshot = ethash_profiling_get_snapshot();
+
+    if (!ethash_profiling_enabled())
+    {
+        for (const auto& c : snapshot.phases)
+        {
+            EXPECT_EQ(c.cycles, 0);
+            EXPECT_EQ(c.events, 0);
+        }
+        return;
+    }
+
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_SEED_KECCAK].events, 1);
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_MIX].events, 1);
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_FNV_MIX].events, 1);
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_FINAL_KECCAK].events, 1);
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_LOOKUP_COMPUTED].events +
+                  snapshot.phases[ETHASH_PROFILING_LOOKUP_READY].events,
+        uint64_t{num_dataset_accesses});
+    EXPECT_GT(snapshot.phases[ETHASH_PROFILING_MIX].cycles,
+        snapshot.phases[ETHASH_PROFILING_FNV_MIX].cycles);
+
+    ethash_profiling_reset();
+    for (const auto& c : ethash_profiling_get_snapshot().phases)
+    {
+        EXPECT_EQ(c.cycles, 0);
+        EXPECT_EQ(c.events, 0);
+    }
+}
+
+TEST(ethash, profiling_item_cache)
+{
+    if (!ethash_profiling_enabled())
+        return;
+
+    auto context = create_epoch_context_mock(0);
+    ASSERT_TRUE(attach_item_cache(*context, 1024 * 1024));
+    const hash256 header_hash = {};
+
+    // The misses are only recorded as the computed lookups.
+    ethash_profiling_reset();
+    hash(*context, header_hash, 1);
+    auto snapshot = ethash_profiling_get_snapshot();
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_LOOKUP_COMPUTED].events,
+        uint64_t{num_dataset_accesses});
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_LOOKUP_READY].events, 0);
+
+    ethash_profiling_reset();
+    hash(*context, header_hash, 1);
+    snapshot = ethash_profiling_get_snapshot();
+    EXPECT_EQ(snapshot.phases[ETHASH_PROFILING_LOOKUP_COMPUTED].events, 0);
+    EXPECT_EQ(
+        snapshot.phases[ETHASH_PROFILING_LOOKUP_READY].events, uint64_t{num_dataset_accesses});
+}
+
 #ifndef __APPLE__
 
 // The Out-Of-Memory tests try to allocate huge memory buffers. This fails on
@@ -6,9 +6,17 @@
 #include "test_cases.hpp"
 #include <ethash/ethash-internal.hpp>
 #include <ethash/global_context.hpp>
+#include <global_context/verify_pool.hpp>
+#include <ethash/sync_verifier.hpp>
+#include <ethash/verify_scheduler.hpp>
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <future>
+#include <mutex>
 #include <thread>
 
 using namespace ethash;
@@ -147,8 +155,8 @@ TEST(managed_multithreaded, get_epoch_context_full)
     for (int i = 0; i < num_threads; ++i)
     {
         futures.emplace_back(std::async(std::launch::async, [] {
-            hash1024* full_dataset1 = get_global_epoch_context_full(7).full_dataset;
-            hash1024* full_dataset2 = get_global_epoch_context_full(7).full_dataset;
+            hash1024* full_dataset1 = get_global_epoch_context_full(7)->full_dataset;
+            hash1024* full_dataset2 = get_global_epoch_context_full(7)->full_dataset;
             return (full_dataset1 == full_dataset2) && (full_dataset1 != nullptr);
         }));
     }
@@ -156,3 +164,819 @@ TEST(managed_multithreaded, get_epoch_context_full)
     for (auto& f : futures)
         EXPECT_TRUE(f.get());
 }
+
+TEST(managed, lru_cache)
+{
+    set_global_context_capacity(3);
+
+    const auto* context0 = &get_global_epoch_context(0);
+    const auto* context1 = &get_global_epoch_context(1);
+    const auto* context2 = &get_global_epoch_context(2);
+    EXPECT_EQ(context0->epoch_number, 0);
+    EXPECT_EQ(context1->epoch_number, 1);
+    EXPECT_EQ(context2->epoch_number, 2);
+
+    // All the contexts are still cached.
+    EXPECT_EQ(&get_global_epoch_context(0), context0);
+    EXPECT_EQ(&get_global_epoch_context(1), context1);
+    EXPECT_EQ(&get_global_epoch_context(2), context2);
+    EXPECT_EQ(&get_global_epoch_context(1), context1);
+
+    // Limit the memory to 2 light caches of epoch 2. Epochs 1 and 2 are kept.
+    const auto light_cache_size = get_light_cache_size(calculate_light_cache_num_items(2));
+    set_global_context_capacity(3, 2 * light_cache_size);
+    EXPECT_EQ(&get_global_epoch_context(2), context2);
+    EXPECT_EQ(&get_global_epoch_context(1), context1);
+    EXPECT_EQ(get_global_epoch_context(0).epoch_number, 0);
+
+    set_global_context_capacity(3);
+}
+
+TEST(managed_multithreaded, lru_cache_eviction)
+{
+    // The contexts are evicted while other threads still use them.
+    set_global_context_capacity(1);
+
+    static constexpr int num_threads = 4;
+
+    std::vector<std::future<bool>> futures;
+    futures.reserve(num_threads);
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+        futures.emplace_back(std::async(std::launch::async, [i] {
+            bool ok = true;
+            for (int j = 0; j < 4; ++j)
+            {
+                const int epoch_number = (i + j) % 3;
+                const auto& context = get_global_epoch_context(epoch_number);
+                const auto item1 = calculate_dataset_item_1024(context, 0);
+                const auto item2 =
+                    calculate_dataset_item_1024(get_global_epoch_context(epoch_number), 0);
+                ok &= context.epoch_number == epoch_number;
+                ok &= std::equal(std::begin(item1.bytes), std::end(item1.bytes), item2.bytes);
+            }
+            return ok;
+        }));
+    }
+
+    for (auto& f : futures)
+        EXPECT_TRUE(f.get());
+
+    set_global_context_capacity(3);
+}
+
+TEST(managed_multithreaded, get_epoch_context_single_build)
+{
+    static constexpr int num_threads = 4;
+
+    std::vector<std::future<const epoch_context*>> futures;
+    futures.reserve(num_threads);
+
+    for (int i = 0; i < num_threads; ++i)
+        futures.emplace_back(std::async(std::launch::async, [] {
+            const auto* context = &get_global_epoch_context(10);
+            get_global_epoch_context(0);  // Release the thread's reference.
+            return context;
+        }));
+
+    const auto* context = futures[0].get();
+    EXPECT_EQ(context->epoch_number, 10);
+    for (size_t i = 1; i < futures.size(); ++i)
+        EXPECT_EQ(futures[i].get(), context);
+}
+
+TEST(managed, try_get_epoch_context)
+{
+    // Use other thread to have the thread-local context empty.
+    auto f = std::async(std::launch::async, [] { return try_get_global_epoch_context(11); });
+    EXPECT_EQ(f.get(), nullptr);
+
+    const auto& context10 = get_global_epoch_context(10);
+    EXPECT_EQ(try_get_global_epoch_context(10), &context10);
+
+    // Null is returned while the new context is being built, the previous one stays valid.
+    auto build = std::async(std::launch::async, [] { return &get_global_epoch_context(11); });
+    const auto* context = try_get_global_epoch_context(11);
+    EXPECT_TRUE(context == nullptr || context->epoch_number == 11);
+    EXPECT_EQ(context10.epoch_number, 10);
+
+    const auto* context11 = build.get();
+    EXPECT_EQ(try_get_global_epoch_context(11), context11);
+    EXPECT_EQ(context11->epoch_number, 11);
+}
+
+namespace
+{
+/// Waits for the prefetched context to be available in the global cache.
+const epoch_context* wait_for_global_epoch_context(int epoch_number)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        const auto* context = try_get_global_epoch_context(epoch_number);
+        if (context != nullptr && context->epoch_number == epoch_number)
+            return context;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return nullptr;
+}
+}  // namespace
+
+TEST(managed, prefetch)
+{
+    prefetch_global_epoch_context(12);
+    const auto* context = wait_for_global_epoch_context(12);
+    ASSERT_NE(context, nullptr);
+    EXPECT_EQ(&get_global_epoch_context(12), context);
+
+    // Invalid epoch numbers are ignored.
+    prefetch_global_epoch_context(-1);
+    prefetch_global_epoch_context(max_epoch_number + 1);
+}
+
+TEST(managed, prefetch_auto)
+{
+    const int next_epoch_start = 13 * ETHASH_EPOCH_LENGTH;
+
+    set_global_context_prefetch_distance(100);
+    update_global_context_head(next_epoch_start - 101);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const auto* context = try_get_global_epoch_context(13);
+    EXPECT_TRUE(context == nullptr || context->epoch_number != 13);
+
+    update_global_context_head(next_epoch_start - 100);
+    EXPECT_NE(wait_for_global_epoch_context(13), nullptr);
+    set_global_context_prefetch_distance(0);
+}
+
+TEST(managed, prepare_full)
+{
+    EXPECT_FALSE(prepare_global_epoch_context_full(-1));
+    EXPECT_FALSE(prepare_global_epoch_context_full(max_epoch_number + 1));
+
+    // Both full contexts do not fit in the memory limit.
+    set_global_context_full_memory_limit(1);
+    EXPECT_FALSE(prepare_global_epoch_context_full(1));
+    EXPECT_EQ(try_get_global_epoch_context_full(1), nullptr);
+    set_global_context_full_memory_limit(0);
+}
+
+TEST(managed, acquire_release)
+{
+    set_global_context_capacity(1);
+
+    auto context = acquire_global_epoch_context(0);
+    ASSERT_NE(context, nullptr);
+    EXPECT_EQ(context->epoch_number, 0);
+    const auto item = calculate_dataset_item_1024(*context, 0);
+
+    // The acquired context stays valid after the eviction.
+    EXPECT_EQ(get_global_epoch_context(1).epoch_number, 1);
+    EXPECT_EQ(try_get_global_epoch_context(0), nullptr);
+    const auto item2 = calculate_dataset_item_1024(*context, 0);
+    EXPECT_TRUE(std::equal(std::begin(item.bytes), std::end(item.bytes), item2.bytes));
+    context.reset();
+
+    EXPECT_EQ(acquire_global_epoch_context(-1), nullptr);
+    ethash_epoch_context_release(nullptr);
+
+    set_global_context_capacity(3);
+}
+
+TEST(managed, purge_thread_local)
+{
+    EXPECT_EQ(get_global_epoch_context(0).epoch_number, 0);
+    auto before = get_global_context_stats();
+    EXPECT_NE(try_get_global_epoch_context(0), nullptr);
+    auto after = get_global_context_stats();
+    EXPECT_EQ(after.thread_local_hits, before.thread_local_hits + 1);
+
+    // Without the thread-local context the global cache is searched.
+    purge_global_context_thread_local();
+    before = after;
+    EXPECT_NE(try_get_global_epoch_context(0), nullptr);
+    after = get_global_context_stats();
+    EXPECT_EQ(after.thread_local_hits, before.thread_local_hits);
+    EXPECT_EQ(after.shared_hits, before.shared_hits + 1);
+}
+
+TEST(managed, light_context_of_full)
+{
+    const auto& light = get_global_epoch_context(15);
+
+    // The light cache is shared with the light context.
+    const auto* full = get_global_epoch_context_full(15);
+    ASSERT_NE(full, nullptr);
+    const epoch_context& light_of_full = *full;
+    EXPECT_EQ(light_of_full.epoch_number, 15);
+    EXPECT_EQ(light_of_full.light_cache, light.light_cache);
+
+    // The memory of the shared light cache is only reported for the light context.
+    const auto usage = get_global_context_memory_usage();
+    const auto it = std::find_if(usage.begin(), usage.end(),
+        [](const global_context_memory_usage& u) { return u.epoch_number == 15 && u.full; });
+    ASSERT_NE(it, usage.end());
+    EXPECT_EQ(it->memory_size, get_full_dataset_size(full->full_dataset_num_items));
+
+    // The light context stays in the cache, so the light requests do not keep the full
+    // dataset alive.
+    auto f = std::async(std::launch::async, [] { return &get_global_epoch_context(15); });
+    EXPECT_EQ(f.get(), &light);
+}
+
+TEST(managed, memory_budget)
+{
+    purge_global_context_thread_local();
+    const auto context = acquire_global_epoch_context(17);
+    ASSERT_NE(context, nullptr);
+    const size_t memory_size = get_light_cache_size(context->light_cache_num_items);
+    EXPECT_GE(get_global_context_memory_size(), memory_size);
+
+    const auto usage = get_global_context_memory_usage();
+    const auto it = std::find_if(usage.begin(), usage.end(),
+        [](const global_context_memory_usage& u) { return u.epoch_number == 17; });
+    ASSERT_NE(it, usage.end());
+    EXPECT_FALSE(it->full);
+    EXPECT_TRUE(it->cached);
+    EXPECT_EQ(it->memory_size, memory_size);
+
+    // The unreferenced contexts are released, the full contexts are refused.
+    set_global_context_memory_budget(1);
+    EXPECT_EQ(get_global_context_memory_size(), memory_size);
+    EXPECT_EQ(acquire_global_epoch_context_full(17), nullptr);
+    EXPECT_FALSE(prepare_global_epoch_context_full(17));
+    set_global_context_memory_budget(0);
+}
+
+TEST(managed, stats)
+{
+    const auto before = get_global_context_stats();
+
+    get_global_epoch_context(18);
+    get_global_epoch_context(18);
+    auto f = std::async(std::launch::async, [] { return &get_global_epoch_context(18); });
+    f.get();
+
+    const auto after = get_global_context_stats();
+    EXPECT_EQ(after.light_builds, before.light_builds + 1);
+    EXPECT_GT(after.light_build_time_ns, before.light_build_time_ns);
+    EXPECT_GT(after.last_light_build_time_ns, 0);
+    EXPECT_EQ(after.misses, before.misses + 1);
+    EXPECT_EQ(after.shared_hits, before.shared_hits + 1);
+    EXPECT_EQ(after.thread_local_hits, before.thread_local_hits + 1);
+    EXPECT_EQ(after.full_builds, before.full_builds);
+    EXPECT_GE(after.memory_size, get_light_cache_size(calculate_light_cache_num_items(18)));
+}
+
+TEST(managed_multithreaded, stats_concurrent_requests)
+{
+    const auto before = get_global_context_stats();
+
+    // The requests waiting for the single build are counted only as misses.
+    constexpr int num_requests = 4;
+    std::vector<std::future<const epoch_context*>> futures;
+    for (int i = 0; i < num_requests; ++i)
+        futures.emplace_back(
+            std::async(std::launch::async, [] { return &get_global_epoch_context(19); }));
+    for (auto& f : futures)
+        EXPECT_EQ(f.get()->epoch_number, 19);
+
+    const auto after = get_global_context_stats();
+    EXPECT_EQ(after.light_builds, before.light_builds + 1);
+    EXPECT_GE(after.misses, before.misses + 1);
+    EXPECT_EQ((after.misses - before.misses) + (after.shared_hits - before.shared_hits),
+        uint64_t{num_requests});
+}
+
+TEST(managed, verify_global)
+{
+    for (const auto& t : hash_test_cases)
+    {
+        const hash256 header_hash = to_hash256(t.header_hash_hex);
+        const hash256 mix_hash = to_hash256(t.mix_hash_hex);
+        const hash256 final_hash = to_hash256(t.final_hash_hex);
+        const uint64_t nonce = std::stoull(t.nonce_hex, nullptr, 16);
+        const int epoch_number = get_epoch_number(t.block_number);
+        EXPECT_EQ(
+            verify_against_boundary_global(epoch_number, header_hash, mix_hash, nonce, final_hash),
+            ETHASH_SUCCESS);
+        EXPECT_EQ(verify_against_boundary_global(
+                      epoch_number, header_hash, mix_hash, nonce, dec(final_hash)),
+            ETHASH_INVALID_FINAL_HASH);
+    }
+}
+
+TEST(managed, verify_global_invalid_epoch)
+{
+    const auto& t = hash_test_cases[0];
+    const hash256 header_hash = to_hash256(t.header_hash_hex);
+    const hash256 mix_hash = to_hash256(t.mix_hash_hex);
+    const hash256 final_hash = to_hash256(t.final_hash_hex);
+    const hash256 difficulty = ethash_difficulty_to_boundary(&final_hash);
+    const uint64_t nonce = std::stoull(t.nonce_hex, nullptr, 16);
+
+    for (const int epoch_number : {-1, max_epoch_number + 1})
+    {
+        EXPECT_EQ(
+            verify_against_boundary_global(epoch_number, header_hash, mix_hash, nonce, final_hash),
+            ETHASH_INVALID_EPOCH_NUMBER);
+        EXPECT_EQ(verify_against_difficulty_global(
+                      epoch_number, header_hash, mix_hash, nonce, difficulty),
+            ETHASH_INVALID_EPOCH_NUMBER);
+        EXPECT_EQ(verify_against_target_global(epoch_number, header_hash, mix_hash, nonce,
+                      ethash_prepare_target(&difficulty)),
+            ETHASH_INVALID_EPOCH_NUMBER);
+    }
+}
+
+TEST(managed, verify_global_full)
+{
+    const hash256 header_hash = {};
+    uint64_t nonce = 3221208;
+    const hash256 difficulty = inc({});
+
+    const auto* context_full = get_global_epoch_context_full(0);
+    ASSERT_NE(context_full, nullptr);
+    const auto& context = *context_full;
+    const auto r = hash(context, header_hash, nonce);
+    EXPECT_EQ(verify_against_difficulty(context, header_hash, r.mix_hash, nonce, difficulty),
+        ETHASH_SUCCESS);
+    EXPECT_EQ(verify_against_difficulty(context, header_hash, {}, nonce, difficulty),
+        ETHASH_INVALID_MIX_HASH);
+    EXPECT_EQ(verify_against_boundary(context, header_hash, r.mix_hash, nonce, r.final_hash),
+        ETHASH_SUCCESS);
+    EXPECT_EQ(verify_against_boundary(context, header_hash, r.mix_hash, nonce, dec(r.final_hash)),
+        ETHASH_INVALID_FINAL_HASH);
+
+    EXPECT_EQ(verify_against_difficulty_global(0, header_hash, r.mix_hash, nonce, difficulty),
+        ETHASH_SUCCESS);
+    EXPECT_EQ(verify_against_difficulty_global(0, header_hash, {}, nonce, difficulty),
+        ETHASH_INVALID_MIX_HASH);
+
+    // The full context is used for verification so the dataset items have been generated.
+    int num_generated = 0;
+    for (int i = 0; i < context.full_dataset_num_items; ++i)
+        num_generated += context.full_dataset[i].word64s[0] != 0;
+    EXPECT_GT(num_generated, 0);
+    EXPECT_LE(num_generated, num_dataset_accesses);
+}
+
+TEST(managed, try_get_epoch_context_full)
+{
+    // Use other thread to have the thread-local context empty.
+    auto f = std::async(std::launch::async, [] { return try_get_global_epoch_context_full(1); });
+    EXPECT_EQ(f.get(), nullptr);
+
+    const auto* context0 = get_global_epoch_context_full(0);
+    ASSERT_NE(context0, nullptr);
+    EXPECT_EQ(try_get_global_epoch_context_full(0), context0);
+
+    // The full context of other epoch is not available, the previous one stays valid.
+    EXPECT_EQ(try_get_global_epoch_context_full(1), nullptr);
+    EXPECT_EQ(try_get_global_epoch_context_full(0), context0);
+}
+
+TEST(managed, memory_budget_refused_full)
+{
+    get_global_epoch_context_full(0);
+
+    // The full context in use is not released for the refused build.
+    set_global_context_full_memory_limit(1);
+    set_global_context_memory_budget(1);
+    EXPECT_EQ(acquire_global_epoch_context_full(1), nullptr);
+    EXPECT_EQ(get_global_epoch_context_full(1), nullptr);
+    set_global_context_memory_budget(0);
+    set_global_context_full_memory_limit(0);
+
+    const auto usage = get_global_context_memory_usage();
+    const auto it = std::find_if(usage.begin(), usage.end(),
+        [](const global_context_memory_usage& u) { return u.epoch_number == 0 && u.full; });
+    ASSERT_NE(it, usage.end());
+    EXPECT_TRUE(it->cached);
+}
+
+TEST(managed_multithreaded, verify_batch)
+{
+    std::vector<header_seal> seals;
+    std::vector<ethash_errc> expected;
+
+    for (const auto& t : hash_test_cases)
+    {
+        const hash256 final_hash = to_hash256(t.final_hash_hex);
+        header_seal seal{};
+        seal.header_hash = to_hash256(t.header_hash_hex);
+        seal.mix_hash = to_hash256(t.mix_hash_hex);
+        seal.difficulty = ethash_difficulty_to_boundary(&final_hash);
+        seal.nonce = std::stoull(t.nonce_hex, nullptr, 16);
+        seal.block_number = t.block_number;
+
+        seals.push_back(seal);
+        expected.push_back(ETHASH_SUCCESS);
+
+        auto invalid_final_hash = seal;
+        invalid_final_hash.difficulty = inc(seal.difficulty);
+        seals.push_back(invalid_final_hash);
+        expected.push_back(ETHASH_INVALID_FINAL_HASH);
+
+        auto invalid_mix_hash = seal;
+        invalid_mix_hash.mix_hash.word64s[3] ^= 1;
+        invalid_mix_hash.difficulty = {};
+        seals.push_back(invalid_mix_hash);
+        expected.push_back(ETHASH_INVALID_MIX_HASH);
+    }
+
+    for (const int block_number : {-1, (max_epoch_number + 1) * ETHASH_EPOCH_LENGTH})
+    {
+        auto invalid_block_number = seals[0];
+        invalid_block_number.block_number = block_number;
+        seals.push_back(invalid_block_number);
+        expected.push_back(ETHASH_INVALID_EPOCH_NUMBER);
+    }
+
+    // Shuffle the seals across the epochs.
+    std::reverse(seals.begin() + 4, seals.end());
+    std::reverse(expected.begin() + 4, expected.end());
+
+    EXPECT_EQ(verify_batch(seals, 4), expected);
+    EXPECT_EQ(verify_batch(seals, 1), expected);
+    EXPECT_TRUE(verify_batch({}).empty());
+}
+
+TEST(managed_multithreaded, verify_batch_shared_difficulty)
+{
+    const auto& t = hash_test_cases[0];
+    const hash256 final_hash = to_hash256(t.final_hash_hex);
+    header_seal seal{};
+    seal.header_hash = to_hash256(t.header_hash_hex);
+    seal.mix_hash = to_hash256(t.mix_hash_hex);
+    seal.difficulty = ethash_difficulty_to_boundary(&final_hash);
+    seal.nonce = std::stoull(t.nonce_hex, nullptr, 16);
+    seal.block_number = t.block_number;
+
+    // The runs of equal difficulties cross the chunk boundaries of the batch.
+    std::vector<header_seal> seals(100, seal);
+    std::vector<ethash_errc> expected(seals.size(), ETHASH_SUCCESS);
+    for (size_t i = 50; i < 90; ++i)
+    {
+        seals[i].difficulty = inc(seal.difficulty);
+        expected[i] = ETHASH_INVALID_FINAL_HASH;
+    }
+    seals[95].difficulty = inc(seal.difficulty);
+    expected[95] = ETHASH_INVALID_FINAL_HASH;
+
+    EXPECT_EQ(verify_batch(seals, 2), expected);
+}
+
+TEST(managed_multithreaded, verify_header_global)
+{
+    const int block_number = 3;
+    const auto difficulty =
+        to_hash256("0000000000000000000000000000000000000000000000000000000000000010");
+    const uint64_t nonce = 0x1234;
+
+    // Compute the seal of the header.
+    auto fields = make_header_fields(block_number, difficulty, hash256{}, nonce);
+    auto header = rlp_encode_list(fields);
+    header_seal seal{};
+    ASSERT_FALSE(decode_header_seal(
+        seal, reinterpret_cast<const uint8_t*>(header.data()), header.size()));
+
+    const auto& context = get_global_epoch_context(0);
+    auto r = hash(context, seal.header_hash, nonce);
+    auto n = nonce;
+    while (!check_against_difficulty(r.final_hash, difficulty))
+        r = hash(context, seal.header_hash, ++n);
+
+    const auto verify = [](const std::string& h) {
+        return verify_header_global(reinterpret_cast<const uint8_t*>(h.data()), h.size());
+    };
+
+    fields = make_header_fields(block_number, difficulty, r.mix_hash, n);
+    header = rlp_encode_list(fields);
+    EXPECT_EQ(verify(header), ETHASH_SUCCESS);
+
+    auto invalid_mix_hash = r.mix_hash;
+    invalid_mix_hash.bytes[31] ^= 1;
+    fields = make_header_fields(block_number, hash256{}, invalid_mix_hash, n);
+    EXPECT_EQ(verify(rlp_encode_list(fields)), ETHASH_INVALID_MIX_HASH);
+
+    const auto max_difficulty =
+        to_hash256("8000000000000000000000000000000000000000000000000000000000000000");
+    fields = make_header_fields(block_number, max_difficulty, r.mix_hash, n);
+    EXPECT_EQ(verify(rlp_encode_list(fields)), ETHASH_INVALID_FINAL_HASH);
+
+    EXPECT_EQ(verify(header.substr(1)), ETHASH_INVALID_HEADER);
+}
+
+namespace
+{
+/// Creates the valid seal, the seal with invalid final hash and the seal with invalid mix hash
+/// out of the test case.
+std::vector<std::pair<header_seal, ethash_errc>> make_test_seals(const hash_test_case& t)
+{
+    const hash256 final_hash = to_hash256(t.final_hash_hex);
+    header_seal seal{};
+    seal.header_hash = to_hash256(t.header_hash_hex);
+    seal.mix_hash = to_hash256(t.mix_hash_hex);
+    seal.difficulty = ethash_difficulty_to_boundary(&final_hash);
+    seal.nonce = std::stoull(t.nonce_hex, nullptr, 16);
+    seal.block_number = t.block_number;
+
+    auto invalid_final_hash = seal;
+    invalid_final_hash.difficulty = inc(seal.difficulty);
+
+    auto invalid_mix_hash = seal;
+    invalid_mix_hash.mix_hash.word64s[3] ^= 1;
+    invalid_mix_hash.difficulty = {};
+
+    return {{seal, ETHASH_SUCCESS}, {invalid_final_hash, ETHASH_INVALID_FINAL_HASH},
+        {invalid_mix_hash, ETHASH_INVALID_MIX_HASH}};
+}
+
+/// The pool configuration shared by the verify_async tests. The pool is also started
+/// by ethash_verify_batch(), so it is configured before any test runs.
+constexpr int async_num_threads = 2;
+constexpr size_t async_max_pending = 8;
+const bool async_configured = ethash_verify_async_configure(async_num_threads, async_max_pending);
+}  // namespace
+
+TEST(verify_async, future)
+{
+    ASSERT_TRUE(async_configured);
+
+    for (const auto& t : {hash_test_cases[0], hash_test_cases[1]})
+    {
+        for (const auto& p : make_test_seals(t))
+        {
+            auto future = verify_async(p.first);
+            EXPECT_EQ(future.get(), p.second);
+        }
+    }
+
+    EXPECT_FALSE(ethash_verify_async_configure(1, 1));
+}
+
+TEST(verify_async, backpressure)
+{
+    ASSERT_TRUE(async_configured);
+
+    struct gate
+    {
+        std::shared_future<void> opened;
+        std::atomic<int> num_valid{0};
+    };
+
+    std::promise<void> open;
+    gate state{open.get_future().share(), {0}};
+    const auto callback = [](const header_seal*, ethash_errc ec, void* user_data) noexcept {
+        auto& g = *static_cast<gate*>(user_data);
+        g.opened.wait();
+        g.num_valid += ec == ETHASH_SUCCESS;
+    };
+
+    const auto seal = make_test_seals(hash_test_cases[0])[0].first;
+    while (ethash_verify_async_get_num_pending() != 0)
+        std::this_thread::yield();
+
+    // The callbacks are blocked, so the requests over the limit are rejected.
+    for (size_t i = 0; i < async_max_pending; ++i)
+        EXPECT_TRUE(ethash_verify_async(&seal, callback, &state));
+    EXPECT_EQ(ethash_verify_async_get_num_pending(), async_max_pending);
+    EXPECT_FALSE(ethash_verify_async(&seal, callback, &state));
+    EXPECT_EQ(verify_async(seal).get(), std::errc::resource_unavailable_try_again);
+
+    open.set_value();
+    while (ethash_verify_async_get_num_pending() != 0)
+        std::this_thread::yield();
+    EXPECT_EQ(state.num_valid, static_cast<int>(async_max_pending));
+    EXPECT_EQ(verify_async(seal).get(), ETHASH_SUCCESS);
+}
+
+TEST(verify_async, loop_helpers_before_backlog)
+{
+    ASSERT_TRUE(async_configured);
+
+    struct gate
+    {
+        std::shared_future<void> opened;
+        std::atomic<int> num_started{0};
+        std::atomic<int> num_done{0};
+    };
+
+    std::promise<void> open;
+    gate state{open.get_future().share(), {0}, {0}};
+    const auto blocked = [](const header_seal*, ethash_errc, void* user_data) noexcept {
+        auto& g = *static_cast<gate*>(user_data);
+        ++g.num_started;
+        g.opened.wait();
+    };
+    const auto counted = [](const header_seal*, ethash_errc, void* user_data) noexcept {
+        ++static_cast<gate*>(user_data)->num_done;
+    };
+
+    const auto seal = make_test_seals(hash_test_cases[0])[0].first;
+    while (ethash_verify_async_get_num_pending() != 0)
+        std::this_thread::yield();
+
+    // Block all the workers and queue the backlog behind them.
+    for (int i = 0; i < async_num_threads; ++i)
+        ASSERT_TRUE(ethash_verify_async(&seal, blocked, &state));
+    while (state.num_started != async_num_threads)
+        std::this_thread::yield();
+    constexpr int backlog = static_cast<int>(async_max_pending) - async_num_threads;
+    for (int i = 0; i < backlog; ++i)
+        ASSERT_TRUE(ethash_verify_async(&seal, counted, &state));
+
+    // The calling thread takes the first iteration and unblocks the workers. The second
+    // iteration is taken by the helping worker before the backlog.
+    const auto caller = std::this_thread::get_id();
+    std::promise<void> helped;
+    auto helped_future = helped.get_future();
+    int backlog_done_when_helped = -1;
+    pool_parallel_for(2, 2, [&](size_t i) noexcept {
+        if (std::this_thread::get_id() != caller)
+        {
+            backlog_done_when_helped = state.num_done;
+            helped.set_value();
+        }
+        else if (i == 0)
+        {
+            open.set_value();
+            helped_future.wait_for(std::chrono::seconds{10});
+        }
+    });
+
+    // The other worker might have verified some of the backlog in the meantime.
+    EXPECT_GE(backlog_done_when_helped, 0);
+    EXPECT_LT(backlog_done_when_helped, backlog / 2);
+
+    while (ethash_verify_async_get_num_pending() != 0)
+        std::this_thread::yield();
+    EXPECT_EQ(state.num_done, backlog);
+}
+
+TEST(verify_scheduler, head_before_backlog)
+{
+    const auto seal = make_test_seals(hash_test_cases[0])[0].first;
+
+    std::promise<void> started;
+    std::promise<void> open;
+    std::shared_future<void> opened = open.get_future().share();
+    std::mutex order_mutex;
+    std::vector<int> order;
+    const auto record = [&](int id) {
+        return [&, id](const header_seal&, std::error_code ec) noexcept {
+            EXPECT_EQ(ec, ETHASH_SUCCESS);
+            std::lock_guard<std::mutex> lock{order_mutex};
+            order.push_back(id);
+        };
+    };
+
+    {
+        verify_scheduler scheduler{1};
+
+        // Keep the only worker busy until all the requests are queued.
+        EXPECT_TRUE(scheduler.submit(seal, verify_scheduler::backlog,
+            [&](const header_seal&, std::error_code ec) noexcept {
+                EXPECT_EQ(ec, ETHASH_SUCCESS);
+                started.set_value();
+                opened.wait();
+            }));
+        started.get_future().wait();
+
+        for (int i = 1; i <= 4; ++i)
+            EXPECT_TRUE(scheduler.submit(seal, verify_scheduler::backlog, record(i)));
+        EXPECT_TRUE(scheduler.submit(seal, verify_scheduler::head, record(0)));
+        open.set_value();
+
+        // The scheduler finishes the queued requests before it is destroyed.
+        EXPECT_EQ(scheduler.verify(seal, verify_scheduler::backlog).get(), ETHASH_SUCCESS);
+
+        const auto head_stats = scheduler.get_stats(verify_scheduler::head);
+        EXPECT_EQ(head_stats.submitted, 1);
+        EXPECT_EQ(head_stats.completed, 1);
+        EXPECT_GE(head_stats.total_latency_ns, head_stats.total_queue_time_ns);
+        EXPECT_EQ(head_stats.max_latency_ns, head_stats.total_latency_ns);
+
+        const auto backlog_stats = scheduler.get_stats(verify_scheduler::backlog);
+        EXPECT_EQ(backlog_stats.submitted, 6);
+        EXPECT_EQ(backlog_stats.completed, 6);
+        EXPECT_GE(backlog_stats.total_latency_ns, backlog_stats.max_latency_ns);
+        EXPECT_GT(backlog_stats.max_latency_ns, 0);
+    }
+
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(verify_scheduler, multiple_producers)
+{
+    verify_scheduler scheduler{2};
+
+    std::vector<std::pair<header_seal, ethash_errc>> seals;
+    for (const auto& t : {hash_test_cases[0], hash_test_cases[1]})
+    {
+        const auto s = make_test_seals(t);
+        seals.insert(seals.end(), s.begin(), s.end());
+    }
+
+    std::vector<std::future<void>> producers;
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto p = i % 2 == 0 ? verify_scheduler::head : verify_scheduler::backlog;
+        producers.emplace_back(std::async(std::launch::async, [&scheduler, &seals, p] {
+            std::vector<std::future<std::error_code>> results;
+            for (const auto& s : seals)
+                results.emplace_back(scheduler.verify(s.first, p));
+            for (size_t j = 0; j < seals.size(); ++j)
+                EXPECT_EQ(results[j].get(), seals[j].second);
+        }));
+    }
+    for (auto& f : producers)
+        f.get();
+
+    for (const auto p : {verify_scheduler::head, verify_scheduler::backlog})
+    {
+        const auto stats = scheduler.get_stats(p);
+        EXPECT_EQ(stats.submitted, 2 * seals.size());
+        EXPECT_EQ(stats.completed, 2 * seals.size());
+    }
+
+    auto out_of_range = seals[2].first;
+    out_of_range.block_number = -1;
+    EXPECT_EQ(scheduler.verify(out_of_range, verify_scheduler::head).get(),
+        std::errc::invalid_argument);
+}
+
+TEST(verify_scheduler, invalid_priority)
+{
+    verify_scheduler scheduler{1};
+    const auto seal = make_test_seals(hash_test_cases[0])[0].first;
+
+    for (const int p : {-1, verify_scheduler::num_priorities, 1000})
+    {
+        const auto priority = static_cast<verify_scheduler::priority>(p);
+        bool invoked = false;
+        EXPECT_FALSE(scheduler.submit(
+            seal, priority, [&invoked](const header_seal&, std::error_code) noexcept {
+                invoked = true;
+            }));
+        EXPECT_EQ(scheduler.verify(seal, priority).get(), std::errc::invalid_argument);
+        const auto stats = scheduler.get_stats(priority);
+        EXPECT_EQ(stats.submitted, 0);
+        EXPECT_FALSE(invoked);
+    }
+    EXPECT_EQ(scheduler.verify(seal, verify_scheduler::head).get(), ETHASH_SUCCESS);
+}
+
+TEST(sync_verifier, verify_multithreaded)
+{
+    sync_verifier verifier;
+
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; ++i)
+    {
+        futures.emplace_back(std::async(std::launch::async, [&verifier] {
+            for (const auto& t : hash_test_cases)
+            {
+                const hash256 final_hash = to_hash256(t.final_hash_hex);
+                header_seal seal{};
+                seal.header_hash = to_hash256(t.header_hash_hex);
+                seal.mix_hash = to_hash256(t.mix_hash_hex);
+                seal.difficulty = ethash_difficulty_to_boundary(&final_hash);
+                seal.nonce = std::stoull(t.nonce_hex, nullptr, 16);
+                seal.block_number = t.block_number;
+                EXPECT_EQ(verifier.verify(seal), ETHASH_SUCCESS);
+
+                seal.nonce += 1;
+                seal.difficulty = {};
+                EXPECT_EQ(verifier.verify(seal), ETHASH_INVALID_MIX_HASH);
+            }
+        }));
+    }
+    for (auto& f : futures)
+        f.wait();
+}
+
+TEST(sync_verifier, contexts)
+{
+    sync_verifier verifier;
+
+    const auto context0 = verifier.get_context(0);
+    ASSERT_NE(context0, nullptr);
+    EXPECT_EQ(context0->epoch_number, 0);
+    EXPECT_EQ(verifier.get_context(0), context0);
+
+    const auto context1 = verifier.get_context(1);
+    ASSERT_NE(context1, nullptr);
+    EXPECT_EQ(context1->epoch_number, 1);
+
+    // The previous epoch is still available.
+    EXPECT_EQ(verifier.get_context(0), context0);
+
+    EXPECT_EQ(verifier.get_context(-1), nullptr);
+    EXPECT_EQ(verifier.get_context(max_epoch_number + 1), nullptr);
+
+    header_seal seal{};
+    seal.block_number = -1;
+    EXPECT_EQ(verifier.verify(seal), std::errc::invalid_argument);
+}
@@ -239,6 +239,29 @@ TEST(keccak, unaligned)
     }
 }
 
+TEST(keccak, ranges)
+{
+    const uint8_t* const data = reinterpret_cast<const uint8_t*>(test_text);
+
+    EXPECT_EQ(to_hex(ethash_keccak256_ranges(nullptr, 0)), test_cases[0].expected_hash256);
+
+    for (auto& t : test_cases)
+    {
+        // Split the input at two points, this covers the ranges not aligned to words and
+        // the ranges crossing the block boundaries.
+        for (size_t a = 0; a <= t.input_size; a += 3)
+        {
+            for (size_t b = a; b <= t.input_size; b += 5)
+            {
+                const ethash_bytes_range ranges[] = {
+                    {data, a}, {data + a, b - a}, {data + b, t.input_size - b}};
+                const auto h = ethash_keccak256_ranges(ranges, 3);
+                ASSERT_EQ(to_hex(h), t.expected_hash256) << t.input_size << " " << a << " " << b;
+            }
+        }
+    }
+}
+
 TEST(keccak, hpp_aliases)
 {
     uint8_t data[64] = {42};
@@ -2,8 +2,33 @@
 // Copyright 2018-2019 Pawel Bylica.
 // Licensed under the Apache License, Version 2.0.
 
+#include <ethash/ethash-internal.hpp>
 #include <ethash/primes.h>
 #include <gtest/gtest.h>
+#include <vector>
+
+namespace
+{
+/// The reference implementation of ethash_find_largest_prime() using trial division.
+int find_largest_prime_trial_division(int upper_bound) noexcept
+{
+    for (int n = upper_bound; n >= 2; --n)
+    {
+        bool prime = true;
+        for (int d = 2; static_cast<int64_t>(d) * d <= n; ++d)
+        {
+            if (n % d == 0)
+            {
+                prime = false;
+                break;
+            }
+        }
+        if (prime)
+            return n;
+    }
+    return 0;
+}
+}  // namespace
 
 TEST(primes, find_largest_prime)
 {
@@ -60,3 +85,41 @@ TEST(primes, find_largest_prime_edge_cases)
     EXPECT_EQ(ethash_find_largest_prime(6), 5);
     EXPECT_EQ(ethash_find_largest_prime(7), 7);
 }
+
+TEST(primes, find_largest_prime_small_numbers)
+{
+    constexpr int limit = 1 << 20;
+    std::vector<bool> composite(limit + 1);
+    for (int i = 2; i * i <= limit; ++i)
+    {
+        if (!composite[static_cast<size_t>(i)])
+        {
+            for (int j = i * i; j <= limit; j += i)
+                composite[static_cast<size_t>(j)] = true;
+        }
+    }
+
+    int largest_prime = 0;
+    for (int n = 2; n <= limit; ++n)
+    {
+        if (!composite[static_cast<size_t>(n)])
+            largest_prime = n;
+        ASSERT_EQ(ethash_find_largest_prime(n), largest_prime) << "n: " << n;
+    }
+}
+
+TEST(primes, find_largest_prime_all_epochs)
+{
+    for (int epoch_number = 0; epoch_number <= ethash::max_epoch_number; ++epoch_number)
+    {
+        const int light_bound = ethash::light_cache_num_items_upper_bound(epoch_number);
+        ASSERT_EQ(ethash_find_largest_prime(light_bound),
+            find_largest_prime_trial_division(light_bound))
+            << "epoch: " << epoch_number;
+
+        const int full_bound = ethash::full_dataset_num_items_upper_bound(epoch_number);
+        ASSERT_EQ(
+            ethash_find_largest_prime(full_bound), find_largest_prime_trial_division(full_bound))
+            << "epoch: " << epoch_number;
+    }
+}